@@ -1,43 +1,284 @@
+import hashlib
+from pathlib import Path
+from xml.sax.saxutils import escape, quoteattr
+
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.const import CONF_ID, CONF_TRIGGER_ID
+from esphome.const import (
+    CONF_ICON,
+    CONF_ID,
+    CONF_NAME,
+    CONF_PRIORITY,
+    CONF_RAW_DATA_ID,
+    CONF_TRIGGER_ID,
+)
+from esphome.core import CORE
 from esphome import automation
+import esphome.final_validate as fv
 
 DEPENDENCIES = ["network"]
+MULTI_CONF = True
 
 CONF_DEVICE_NAME = "device_name"
 CONF_PORT = "port"
+CONF_KEEP_ALIVE_TIMEOUT = "keep_alive_timeout"
+CONF_MAX_REQUESTS_PER_CONNECTION = "max_requests_per_connection"
+CONF_NOTIFY_INTERVAL = "notify_interval"
+CONF_NOTIFY_TARGETS = "notify_targets"
+CONF_NETWORK_TASK = "network_task"
+CONF_CORE = "core"
+CONF_STACK_SIZE = "stack_size"
+CONF_KEY_REPEAT = "key_repeat"
+CONF_DELAY = "delay"
+CONF_INTERVAL = "interval"
+CONF_RELEASE_TIMEOUT = "release_timeout"
 CONF_ON_KEY_PRESS = "on_key_press"
+CONF_ON_KEY_EVENT = "on_key_event"
+CONF_ON_TEXT_INPUT = "on_text_input"
+CONF_ON_LAUNCH = "on_launch"
+CONF_APPS = "apps"
+CONF_APP_ID = "app_id"
+
+MAX_APPS = 32
+# The shared SSDP responder's device table is sized to the configured devices
+MAX_DEVICES = 8
+# device-info stores the name once, next to ids, MACs and network type, in a
+# 192-byte arena (TemplateResponse::FIELDS_SIZE); those take up to 92 bytes.
+# Counted in UTF-8 bytes, as the arena is
+MAX_DEVICE_NAME_LENGTH = 100
+ICON_TYPES = {".png": "image/png", ".jpg": "image/jpeg", ".jpeg": "image/jpeg"}
+CONF_TEXT_INPUT_DEBOUNCE = "text_input_debounce"
+CONF_TRACE_SIZE = "trace_size"
 
 emulated_roku_ns = cg.esphome_ns.namespace("emulated_roku")
 EmulatedRokuComponent = emulated_roku_ns.class_("EmulatedRokuComponent", cg.Component)
+RokuKeyEvent = emulated_roku_ns.struct("RokuKeyEvent")
 KeyPressTrigger = emulated_roku_ns.class_(
     "KeyPressTrigger", automation.Trigger.template(cg.std_string, cg.std_string)
 )
+KeyEventTrigger = emulated_roku_ns.class_(
+    "KeyEventTrigger", automation.Trigger.template(RokuKeyEvent)
+)
+LaunchTrigger = emulated_roku_ns.class_(
+    "LaunchTrigger", automation.Trigger.template(cg.std_string, cg.std_string)
+)
+TextInputTrigger = emulated_roku_ns.class_(
+    "TextInputTrigger", automation.Trigger.template(cg.std_string, cg.std_string)
+)
+
+NETWORK_TASK_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_CORE, default=0): cv.int_range(min=0, max=1),
+        cv.Optional(CONF_PRIORITY, default=5): cv.int_range(min=1, max=24),
+        cv.Optional(CONF_STACK_SIZE, default=4096): cv.int_range(min=2048, max=32768),
+    }
+)
+
+KEY_REPEAT_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_DELAY, default="500ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_INTERVAL, default="100ms"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=20)),
+        ),
+        # A keyup lost on the network would otherwise repeat forever
+        cv.Optional(
+            CONF_RELEASE_TIMEOUT, default="10s"
+        ): cv.positive_time_period_milliseconds,
+    }
+)
+
+
+def _validate_device_name(value):
+    value = cv.string(value)
+    if len(value.encode("utf-8")) > MAX_DEVICE_NAME_LENGTH:
+        raise cv.Invalid(
+            f"Device name must be at most {MAX_DEVICE_NAME_LENGTH} bytes as UTF-8"
+        )
+    return value
+
+
+def _validate_icon(value):
+    value = cv.file_(value)
+    if Path(value).suffix.lower() not in ICON_TYPES:
+        raise cv.Invalid(f"App icons must be one of {', '.join(ICON_TYPES)}")
+    return value
+
+
+def _validate_apps(apps):
+    if len(apps) > MAX_APPS:
+        raise cv.Invalid(f"At most {MAX_APPS} apps are supported")
+    seen = set()
+    for app in apps:
+        if app[CONF_APP_ID] in seen:
+            raise cv.Invalid(f"App id {app[CONF_APP_ID]} is listed more than once")
+        seen.add(app[CONF_APP_ID])
+    return apps
+
+
+APP_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_APP_ID): cv.All(cv.string_strict, cv.Length(min=1, max=64)),
+        cv.Required(CONF_NAME): cv.string_strict,
+        cv.Optional(CONF_ICON): _validate_icon,
+        cv.GenerateID(CONF_RAW_DATA_ID): cv.declare_id(cg.uint8),
+    }
+)
 
 CONFIG_SCHEMA = cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(EmulatedRokuComponent),
-        cv.Optional(CONF_DEVICE_NAME, default="ESPHome Roku"): cv.string,
+        cv.Optional(CONF_DEVICE_NAME, default="ESPHome Roku"): _validate_device_name,
         cv.Optional(CONF_PORT, default=8060): cv.port,
+        cv.Optional(
+            CONF_KEEP_ALIVE_TIMEOUT, default="15s"
+        ): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_REQUESTS_PER_CONNECTION, default=100): cv.int_range(
+            min=1, max=65535
+        ),
+        # SSDP NOTIFYs back off to this after a quick startup burst; at most
+        # half the advertised max-age of 300s
+        cv.Optional(CONF_NOTIFY_INTERVAL, default="60s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(seconds=1), max=cv.TimePeriod(seconds=150)),
+        ),
+        cv.Optional(CONF_NOTIFY_TARGETS, default=[]): cv.ensure_list(cv.ipv4address),
+        cv.Optional(CONF_APPS): cv.All(cv.ensure_list(APP_SCHEMA), _validate_apps),
+        cv.Optional(CONF_KEY_REPEAT): KEY_REPEAT_SCHEMA,
+        # Pause in typing after which collected Lit_ characters are delivered
+        cv.Optional(
+            CONF_TEXT_INPUT_DEBOUNCE, default="1s"
+        ): cv.positive_time_period_milliseconds,
+        # Key events kept in the /query/trace ring, 36 bytes each; 0 turns
+        # tracing off and allocates nothing
+        cv.Optional(CONF_TRACE_SIZE, default=0): cv.int_range(min=0, max=1024),
+        cv.Optional(CONF_NETWORK_TASK): cv.All(
+            NETWORK_TASK_SCHEMA, cv.only_on_esp32
+        ),
         cv.Optional(CONF_ON_KEY_PRESS): automation.validate_automation(
             {
                 cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(KeyPressTrigger),
             }
         ),
+        cv.Optional(CONF_ON_KEY_EVENT): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(KeyEventTrigger),
+            }
+        ),
+        cv.Optional(CONF_ON_LAUNCH): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(LaunchTrigger),
+            }
+        ),
+        cv.Optional(CONF_ON_TEXT_INPUT): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(TextInputTrigger),
+            }
+        ),
     }
 ).extend(cv.COMPONENT_SCHEMA)
 
 
+def _validate_devices(config):
+    # Every device on the board needs its own ECP port; SSDP is shared
+    devices = fv.full_config.get().get("emulated_roku", [])
+    if len(devices) > MAX_DEVICES:
+        raise cv.Invalid(f"At most {MAX_DEVICES} emulated_roku devices can share SSDP")
+    if sum(1 for conf in devices if conf[CONF_PORT] == config[CONF_PORT]) > 1:
+        raise cv.Invalid(
+            f"Port {config[CONF_PORT]} is used by more than one emulated_roku device",
+            path=[CONF_PORT],
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _validate_devices
+
+
+def _apps_to_code(var, apps):
+    # /query/apps is answered with this string as is, straight from flash
+    xml = "<apps>\n"
+    for app in apps:
+        xml += f'    <app id={quoteattr(app[CONF_APP_ID])} version="1.0.0">{escape(app[CONF_NAME])}</app>\n'
+    xml += "</apps>"
+    cg.add(var.set_apps_xml(xml))
+
+    for app in apps:
+        if CONF_ICON not in app:
+            cg.add(var.add_app(app[CONF_APP_ID], app[CONF_NAME], cg.nullptr, 0, "", ""))
+            continue
+        path = Path(CORE.relative_config_path(app[CONF_ICON]))
+        data = path.read_bytes()
+        icon = cg.progmem_array(app[CONF_RAW_DATA_ID], list(data))
+        # Changes with the icon's content, so a new icon is never served stale
+        etag = f'"{hashlib.sha1(data).hexdigest()[:16]}"'
+        cg.add(
+            var.add_app(
+                app[CONF_APP_ID],
+                app[CONF_NAME],
+                icon,
+                len(data),
+                ICON_TYPES[path.suffix.lower()],
+                etag,
+            )
+        )
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
+    cg.add_define("EMULATED_ROKU_DEVICE_COUNT", len(CORE.config["emulated_roku"]))
 
     cg.add(var.set_device_name(config[CONF_DEVICE_NAME]))
     cg.add(var.set_port(config[CONF_PORT]))
+    cg.add(var.set_keep_alive_timeout(config[CONF_KEEP_ALIVE_TIMEOUT]))
+    cg.add(
+        var.set_max_requests_per_connection(config[CONF_MAX_REQUESTS_PER_CONNECTION])
+    )
+
+    cg.add(var.set_notify_interval(config[CONF_NOTIFY_INTERVAL]))
+    for target in config[CONF_NOTIFY_TARGETS]:
+        cg.add(var.add_notify_target(str(target)))
+
+    if apps := config.get(CONF_APPS):
+        _apps_to_code(var, apps)
+
+    if repeat := config.get(CONF_KEY_REPEAT):
+        cg.add(
+            var.set_key_repeat(
+                repeat[CONF_DELAY], repeat[CONF_INTERVAL], repeat[CONF_RELEASE_TIMEOUT]
+            )
+        )
+
+    if config[CONF_TRACE_SIZE]:
+        cg.add(var.set_trace_size(config[CONF_TRACE_SIZE]))
+
+    if task := config.get(CONF_NETWORK_TASK):
+        cg.add(
+            var.set_network_task(
+                task[CONF_CORE], task[CONF_PRIORITY], task[CONF_STACK_SIZE]
+            )
+        )
 
     for conf in config.get(CONF_ON_KEY_PRESS, []):
         trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
         await automation.build_automation(
             trigger, [(cg.std_string, "type"), (cg.std_string, "key")], conf
         )
+
+    for conf in config.get(CONF_ON_KEY_EVENT, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(RokuKeyEvent, "event")], conf)
+
+    for conf in config.get(CONF_ON_LAUNCH, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(
+            trigger, [(cg.std_string, "app_id"), (cg.std_string, "app_name")], conf
+        )
+
+    cg.add(var.set_text_input_debounce(config[CONF_TEXT_INPUT_DEBOUNCE]))
+    for conf in config.get(CONF_ON_TEXT_INPUT, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(
+            trigger, [(cg.std_string, "text"), (cg.std_string, "source")], conf
+        )
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "esphome/core/log.h"
+#include "keys.h"
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace emulated_roku {
+
+// An app from the YAML catalog. Every pointer refers to data generated at
+// compile time (string literals, icon bytes in flash) and is never copied.
+struct RokuApp {
+  const char *id;
+  const char *name;
+  const uint8_t *icon;  // nullptr for the placeholder icon
+  size_t icon_len;
+  const char *icon_type;
+  const char *icon_etag;
+};
+
+// The apps behind /query/apps, /query/icon/<id> and /launch/<id>. Ids are
+// found through a perfect hash table, seeded once when the catalog is
+// complete, so a lookup is one hash and one compare however many apps there
+// are. Uses the same hash as the key table.
+class AppCatalog {
+ public:
+  static const uint8_t MAX_APPS = 32;
+  static const uint8_t TABLE_SIZE = 128;
+  static const uint32_t MAX_SEED_ATTEMPTS = 10000;
+
+  bool add(const RokuApp &app) {
+    if (count_ == MAX_APPS) {
+      ESP_LOGW("emulated_roku", "Too many apps, ignoring %s", app.id);
+      return false;
+    }
+    apps_[count_++] = app;
+    seeded_ = false;
+    return true;
+  }
+
+  // Picks a seed under which no two ids share a slot. Without one (which
+  // takes an unlucky set of ids) lookups fall back to a linear scan.
+  void build() {
+    for (uint32_t seed = 0; seed < MAX_SEED_ATTEMPTS; seed++) {
+      if (try_seed_(seed)) {
+        seed_ = seed;
+        seeded_ = true;
+        return;
+      }
+    }
+    ESP_LOGW("emulated_roku", "No perfect hash for the app ids, using a linear search");
+  }
+
+  const RokuApp *find(const char *id) const {
+    size_t len = strlen(id);
+    if (seeded_) {
+      uint8_t index = slots_[slot_(id, len, seed_)];
+      if (index == 0)
+        return nullptr;
+      const RokuApp &app = apps_[index - 1];
+      return strcmp(app.id, id) == 0 ? &app : nullptr;
+    }
+    for (uint8_t i = 0; i < count_; i++) {
+      if (strcmp(apps_[i].id, id) == 0)
+        return &apps_[i];
+    }
+    return nullptr;
+  }
+
+  uint8_t size() const { return count_; }
+
+ protected:
+  static uint8_t slot_(const char *id, size_t len, uint32_t seed) {
+    return roku_key_hash(id, len, seed) % TABLE_SIZE;
+  }
+
+  bool try_seed_(uint32_t seed) {
+    memset(slots_, 0, sizeof(slots_));
+    for (uint8_t i = 0; i < count_; i++) {
+      uint8_t slot = slot_(apps_[i].id, strlen(apps_[i].id), seed);
+      if (slots_[slot] != 0)
+        return false;
+      slots_[slot] = i + 1;
+    }
+    return true;
+  }
+
+  RokuApp apps_[MAX_APPS];
+  uint8_t count_{0};
+  uint8_t slots_[TABLE_SIZE]{};  // Index into apps_ plus one, 0 for empty slots
+  uint32_t seed_{0};
+  bool seeded_{false};
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
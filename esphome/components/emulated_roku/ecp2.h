@@ -0,0 +1,138 @@
+#pragma once
+
+#include "sha1.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace esphome {
+namespace emulated_roku {
+
+// ECP-2 is ECP over a WebSocket at /ecp-session (subprotocol "ecp-2"), as used
+// by the Roku mobile app. Each message is one flat JSON object:
+//
+//   <- {"notify":"authenticate","param-challenge":"...","timestamp":"..."}
+//   -> {"request":"authenticate","request-id":"1","param-response":"..."}
+//   <- {"response":"authenticate","request-id":"1","response-code":"200",...}
+//   -> {"request":"key-press","request-id":"2","param-key":"Select"}
+//
+// The client proves itself with base64(SHA-1(challenge + key)) for a key
+// every client ships with. It is stored here already run through the
+// per-digit transform clients apply to the published form.
+static const char *const ECP2_AUTH_KEY = "F3A278B8-1C6F-44A9-9D89-F1979CA4C6F1";
+static const char *const ECP2_PROTOCOL = "ecp-2";
+
+// Fields of an ECP-2 request, pointing into the message buffer. Absent fields
+// are nullptr.
+struct Ecp2Request {
+  char *request{nullptr};
+  char *request_id{nullptr};
+  char *param_key{nullptr};
+  char *param_response{nullptr};
+  char *param_channel_id{nullptr};
+};
+
+// State of the session on one connection slot
+struct Ecp2Session {
+  char challenge[25];  // base64 of 16 random bytes
+  bool authenticated{false};
+};
+
+// Splits a flat JSON object of string fields in place: each string value is
+// unescaped and NUL-terminated where it lies. Numbers, booleans and nested
+// values aren't used by ECP-2 requests and are skipped. Only the len bytes at
+// json are read, the message needn't be NUL-terminated. Returns false if the
+// message isn't an object.
+inline bool parse_ecp2_request(char *json, size_t len, Ecp2Request *request) {
+  char *p = json;
+  char *end = json + len;
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    p++;
+  if (p == end || *p++ != '{')
+    return false;
+  for (;;) {
+    char *name = (char *) memchr(p, '"', end - p);
+    if (name == nullptr)
+      return true;
+    name++;
+    char *name_end = (char *) memchr(name, '"', end - name);
+    if (name_end == nullptr)
+      return false;
+    *name_end = '\0';
+    p = name_end + 1;
+    while (p < end && (*p == ' ' || *p == ':'))
+      p++;
+    if (p == end || *p != '"') {
+      // Not a string, skip to the next field
+      while (p < end && *p != ',' && *p != '}')
+        p++;
+      continue;
+    }
+
+    // Unescape the value in place, the closing quote always ends up behind it
+    char *value = ++p;
+    char *out = value;
+    while (p < end && *p != '"') {
+      if (*p == '\\' && p + 1 < end) {
+        p++;
+        switch (*p) {
+          case 'n':
+            *out++ = '\n';
+            break;
+          case 't':
+            *out++ = '\t';
+            break;
+          case 'u': {
+            // Six characters in, at most three UTF-8 bytes out
+            char hex[5] = {};
+            for (int i = 0; i < 4 && p + i + 1 < end; i++)
+              hex[i] = p[i + 1];
+            uint32_t cp = strtoul(hex, nullptr, 16);
+            if (cp < 0x80) {
+              *out++ = (char) cp;
+            } else if (cp < 0x800) {
+              *out++ = (char) (0xC0 | cp >> 6);
+              *out++ = (char) (0x80 | (cp & 0x3F));
+            } else {
+              *out++ = (char) (0xE0 | cp >> 12);
+              *out++ = (char) (0x80 | ((cp >> 6) & 0x3F));
+              *out++ = (char) (0x80 | (cp & 0x3F));
+            }
+            p += strlen(hex);
+            break;
+          }
+          default:
+            *out++ = *p;
+            break;
+        }
+        p++;
+      } else {
+        *out++ = *p++;
+      }
+    }
+    if (p == end)
+      return false;
+    p++;
+    *out = '\0';
+
+    if (strcmp(name, "request") == 0) {
+      request->request = value;
+    } else if (strcmp(name, "request-id") == 0) {
+      request->request_id = value;
+    } else if (strcmp(name, "param-key") == 0) {
+      request->param_key = value;
+    } else if (strcmp(name, "param-response") == 0) {
+      request->param_response = value;
+    } else if (strcmp(name, "param-channel-id") == 0) {
+      request->param_channel_id = value;
+    }
+  }
+}
+
+// The response an authenticating client should send for this challenge
+inline void ecp2_expected_response(const char *challenge, char out[29]) {
+  sha1_base64(challenge, ECP2_AUTH_KEY, out);
+}
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -2,24 +2,33 @@
 
 #include "esphome/core/component.h"
 #include "esphome/core/automation.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
 #include "esphome/components/network/util.h"
-#include <WiFi.h>
-#include <WiFiUdp.h>
-#include <WebServer.h>
-#include <lwip/igmp.h>
-#include <lwip/ip_addr.h>
-#include <lwip/tcpip.h>
-#include <lwip/sockets.h>
-#include <lwip/netdb.h>
+#include "http_server.h"
+#include "key_repeat.h"
+#include "apps.h"
+#include "ecp2.h"
+#include "keys.h"
+#include "net_compat.h"
+#include "net_interfaces.h"
+#include "routes.h"
+#include "spsc_queue.h"
+#include "ssdp_responder.h"
+#include "stats.h"
+#include "text_input.h"
+#include "trace.h"
+#ifndef USE_HOST
 #include <esp_wifi.h>
+#endif
+#ifdef USE_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
 
 namespace esphome {
 namespace emulated_roku {
 
-// SSDP Constants
-static const uint16_t SSDP_PORT = 1900;
-static const IPAddress SSDP_MULTICAST_ADDR(239, 255, 255, 250);
-
 // Device description matching real Roku 4 format exactly
 static const char* ROKU_DEVICE_INFO_TEMPLATE = R"(<?xml version="1.0" encoding="UTF-8" ?>
 <root xmlns="urn:schemas-upnp-org:device-1-0">
@@ -79,7 +88,7 @@ static const char* ROKU_DEVICE_INFO_QUERY = R"(<?xml version="1.0" encoding="UTF
   <has-wifi-5G-support>true</has-wifi-5G-support>
   <can-use-wifi-extender>true</can-use-wifi-extender>
   <ethernet-mac>%s</ethernet-mac>
-  <network-type>wifi</network-type>
+  <network-type>%s</network-type>
   <friendly-device-name>%s</friendly-device-name>
   <friendly-model-name>Roku 4</friendly-model-name>
   <default-device-name>%s</default-device-name>
@@ -127,19 +136,157 @@ static const char* ROKU_DEVICE_INFO_QUERY = R"(<?xml version="1.0" encoding="UTF
   <davinci-version>2.8.20</davinci-version>
 </device-info>)";
 
+// 1x1 transparent PNG, served for apps without an icon
+static const uint8_t PLACEHOLDER_ICON[] = {
+  0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D,
+  0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+  0x08, 0x06, 0x00, 0x00, 0x00, 0x1F, 0x15, 0xC4, 0x89, 0x00, 0x00, 0x00,
+  0x0A, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9C, 0x63, 0x00, 0x01, 0x00, 0x00,
+  0x05, 0x00, 0x01, 0x0D, 0x0A, 0x2D, 0xB4, 0x00, 0x00, 0x00, 0x00, 0x49,
+  0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82
+};
+static const char *const PLACEHOLDER_ICON_ETAG = "\"placeholder\"";
+// Icons only change with the firmware, and then their ETag changes too
+static const uint32_t ICON_MAX_AGE = 86400;
+
+// A key event on its way from the network task to the main loop
+struct QueuedKeyEvent {
+  RokuKeyEvent event;
+  char name[24];  // Decoded key name as received, for on_key_press
+  uint32_t trace_id;  // 0 unless tracing
+};
+
+enum TextEventSource : uint8_t {
+  TEXT_EVENT_SEARCH,
+  TEXT_EVENT_INPUT,
+  TEXT_EVENT_LAUNCH,  // text is the app id
+};
+
+// A search, /input parameter or app launch on its way from the network task
+// to the main loop
+struct QueuedTextEvent {
+  TextEventSource source;
+  char text[TextAssembler::MAX_TEXT + 1];
+};
+
+static const uint16_t DEFAULT_PORT = 8060;
+// What fits in the device-info field arena next to the ids, MACs and network
+// type (up to 92 bytes of TemplateResponse::FIELDS_SIZE); see __init__.py
+static const size_t MAX_DEVICE_NAME_LENGTH = 100;
+static const size_t KEY_QUEUE_SIZE = 16;
+static const size_t TEXT_QUEUE_SIZE = 4;
+static const size_t NETWORK_QUEUE_SIZE = 2;
+// Keep the high-frequency loop on this long after the last network activity
+static const uint32_t HIGH_FREQUENCY_TAIL = 1000;
+// The network task sleeps in select() for at most this long between timer checks
+static const uint32_t NETWORK_TASK_WAIT_MS = 20;
+// How often the main loop looks for a lost connection or a new address
+static const uint32_t NETWORK_CHECK_INTERVAL = 1000;
+static const size_t RENAME_QUEUE_SIZE = 2;
+
+// A new device name on its way to the serving task, see set_device_name()
+struct QueuedDeviceName {
+  char name[MAX_DEVICE_NAME_LENGTH + 1];
+};
+
 class EmulatedRokuComponent : public Component {
  public:
-  void set_device_name(const std::string &name) { device_name_ = name; }
+  // Once the servers run, the name and the bodies built from it belong to the
+  // serving task, so a rename is queued for it like a network change
+  void set_device_name(const std::string &name) {
+    // Cut at a character boundary, never inside a UTF-8 sequence
+    size_t len = name.size();
+    if (len > MAX_DEVICE_NAME_LENGTH) {
+      ESP_LOGE("emulated_roku", "Device name longer than %u bytes, hubs will see it cut short",
+               (unsigned) MAX_DEVICE_NAME_LENGTH);
+      len = MAX_DEVICE_NAME_LENGTH;
+      while (len > 0 && (name[len] & 0xC0) == 0x80)
+        len--;
+    }
+    if (!initialized_) {
+      device_name_.assign(name, 0, len);
+      return;
+    }
+    QueuedDeviceName item;
+    memcpy(item.name, name.data(), len);
+    item.name[len] = '\0';
+    if (!rename_queue_.push(item)) {
+      ESP_LOGW("emulated_roku", "Rename queue full, dropping %s", item.name);
+    }
+  }
   void set_port(uint16_t port) { port_ = port; }
+  void set_keep_alive_timeout(uint32_t timeout) { keep_alive_timeout_ = timeout; }
+  void set_max_requests_per_connection(uint16_t max_requests) { max_requests_per_connection_ = max_requests; }
+  void set_notify_interval(uint32_t interval) { notify_interval_ = interval; }
+  void add_notify_target(const std::string &ip) { notify_targets_.push_back(inet_addr(ip.c_str())); }
+  // Repeat held keys (keydown without keyup) natively instead of in YAML
+  void set_key_repeat(uint32_t delay, uint32_t interval, uint32_t release_timeout) {
+    key_repeat_ = true;
+    key_repeater_.configure(delay, interval, release_timeout);
+  }
+  void set_network_task(uint8_t core, uint8_t priority, uint32_t stack_size) {
+    use_network_task_ = true;
+    network_task_core_ = core;
+    network_task_priority_ = priority;
+    network_task_stack_size_ = stack_size;
+  }
+  // Records per-stage timestamps for the last `size` key events, see /query/trace
+  void set_trace_size(uint16_t size) { trace_.set_capacity(size); }
+  // Pauses or resumes tracing at runtime, e.g. from a lambda
+  void set_trace_enabled(bool enabled) { trace_.set_enabled(enabled); }
   
   void add_on_key_press_callback(std::function<void(std::string, std::string)> callback) {
     key_press_callback_.add(std::move(callback));
   }
+  void add_on_key_event_callback(std::function<void(RokuKeyEvent)> callback) {
+    key_event_callback_.add(std::move(callback));
+  }
+  // With a listener, Lit_ keypresses are collected into text instead of
+  // firing key triggers one character at a time
+  void add_on_text_input_callback(std::function<void(std::string, std::string)> callback) {
+    text_input_callback_.add(std::move(callback));
+  }
+  void set_text_input_debounce(uint32_t debounce) { text_assembler_.set_debounce(debounce); }
+  void add_on_launch_callback(std::function<void(std::string, std::string)> callback) {
+    launch_callback_.add(std::move(callback));
+  }
+
+  // The app catalog is generated from YAML: the /query/apps body is built at
+  // compile time and every pointer passed here refers to static data
+  void set_apps_xml(const char *xml) { apps_xml_ = xml; }
+  void add_app(const char *id, const char *name, const uint8_t *icon, size_t icon_len, const char *icon_type,
+               const char *icon_etag) {
+    app_catalog_.add(RokuApp{id, name, icon, icon_len, icon_type, icon_etag});
+  }
+
+  // Shared by all devices on the board; empty until the network is up
+  const SsdpStats &get_ssdp_stats() const {
+    static const SsdpStats NONE;
+    return global_ssdp_responder != nullptr ? global_ssdp_responder->get_stats() : NONE;
+  }
+  const EcpStats &get_ecp_stats() const { return ecp_stats_; }
+  const HttpStats *get_http_stats() const { return server_ != nullptr ? &server_->get_stats() : nullptr; }
+  size_t get_key_queue_depth() const { return key_queue_.size(); }
+  size_t get_key_queue_high_water() const { return key_queue_.high_water(); }
+  uint32_t get_key_queue_overflows() const { return key_queue_.overflows(); }
+  const KeyRepeatStats &get_key_repeat_stats() const { return key_repeater_.get_stats(); }
+  const TextInputStats &get_text_input_stats() const { return text_assembler_.get_stats(); }
 
   void setup() override {
-    // Generate a simple UUID from MAC address
-    snprintf(uuid_, sizeof(uuid_), "roku-ecp-%08X", (uint32_t)ESP.getEfuseMac());
-    snprintf(usn_, sizeof(usn_), "ESP32-%08X", (uint32_t)ESP.getEfuseMac());
+    // Generate a simple UUID from MAC address, using the low four bytes in the
+    // same order ESP.getEfuseMac() returned them so existing pairings survive.
+    // Further devices on the same board are told apart by their port.
+    uint8_t mac[6];
+    get_mac_address_raw(mac);
+    uint32_t id = mac[0] | (mac[1] << 8) | (mac[2] << 16) | ((uint32_t) mac[3] << 24);
+    if (port_ == DEFAULT_PORT) {
+      snprintf(uuid_, sizeof(uuid_), "roku-ecp-%08X", id);
+      snprintf(usn_, sizeof(usn_), "ESP32-%08X", id);
+    } else {
+      snprintf(uuid_, sizeof(uuid_), "roku-ecp-%08X-%u", id, port_);
+      snprintf(usn_, sizeof(usn_), "ESP32-%08X-%u", id, port_);
+    }
+    app_catalog_.build();
     ESP_LOGI("emulated_roku", "Emulated Roku '%s' initialized", device_name_.c_str());
   }
 
@@ -149,14 +296,84 @@ class EmulatedRokuComponent : public Component {
       if (network::is_connected()) {
         start_servers();
         initialized_ = true;
+        if (use_network_task_) {
+          start_network_task();
+        }
       }
       return;
     }
-    
-    if (server_ != nullptr) {
-      server_->handleClient();
+
+    check_network();
+
+    if (network_task_running_) {
+      // The network task does the I/O, triggers still fire here on the main task
+      QueuedKeyEvent item;
+      while (key_queue_.pop(item)) {
+        fire_key_event(item.event, item.name, item.trace_id);
+      }
+      QueuedTextEvent text;
+      while (text_queue_.pop(text)) {
+        fire_text_event(text.source, text.text);
+      }
+      run_key_timers();
+      if (millis() - last_io_ < HIGH_FREQUENCY_TAIL || key_repeater_.active()) {
+        high_freq_.start();
+      } else {
+        high_freq_.stop();
+      }
+      return;
+    }
+
+    bool active = poll_network(0);
+    run_key_timers();
+    if (active || key_repeater_.active()) {
+      // Loop at full speed while a remote is active so follow-up requests in a
+      // burst aren't held back by the regular loop interval, and while a key
+      // is held so its repeats keep time
+      high_freq_.start();
+    } else if (millis() - last_io_ > HIGH_FREQUENCY_TAIL) {
+      high_freq_.stop();
+    }
+  }
+
+  void dump_config() override {
+    ESP_LOGCONFIG("emulated_roku", "Emulated Roku:");
+    ESP_LOGCONFIG("emulated_roku", "  Device Name: %s", device_name_.c_str());
+    ESP_LOGCONFIG("emulated_roku", "  Port: %d", port_);
+    ESP_LOGCONFIG("emulated_roku", "  Keep-Alive Timeout: %u ms", (unsigned) keep_alive_timeout_);
+    ESP_LOGCONFIG("emulated_roku", "  Max Requests Per Connection: %d", max_requests_per_connection_);
+    ESP_LOGCONFIG("emulated_roku", "  Notify Interval: %u ms", (unsigned) notify_interval_);
+    for (uint32_t target : notify_targets_) {
+      struct in_addr addr;
+      addr.s_addr = target;
+      char ip[16];
+      inet_ntoa_r(addr, ip, sizeof(ip));
+      ESP_LOGCONFIG("emulated_roku", "  Notify Target: %s", ip);
+    }
+    for (uint8_t i = 0; i < detected_.count; i++) {
+      ESP_LOGCONFIG("emulated_roku", "  Interface: %s (%s)", detected_.list[i].ip,
+                    detected_.list[i].ethernet ? "ethernet" : "wifi");
+    }
+    if (ssdp_ != nullptr) {
+      ESP_LOGCONFIG("emulated_roku", "  SSDP: shared by %d device(s)%s", ssdp_->device_count(),
+                    ssdp_owner_ ? ", driven by this device" : "");
+    }
+    if (key_repeat_) {
+      ESP_LOGCONFIG("emulated_roku", "  Key Repeat: after %u ms, every %u ms, release after %u ms",
+                    (unsigned) key_repeater_.get_delay(), (unsigned) key_repeater_.get_interval(),
+                    (unsigned) key_repeater_.get_release_timeout());
+    }
+    ESP_LOGCONFIG("emulated_roku", "  Apps: %u", app_catalog_.size());
+    if (this->text_input_callback_.size() > 0) {
+      ESP_LOGCONFIG("emulated_roku", "  Text Input Debounce: %u ms", (unsigned) text_assembler_.get_debounce());
+    }
+    if (trace_.get_capacity() != 0) {
+      ESP_LOGCONFIG("emulated_roku", "  Trace: last %u key events", trace_.get_capacity());
+    }
+    if (use_network_task_) {
+      ESP_LOGCONFIG("emulated_roku", "  Network Task: core %d, priority %d, stack %u",
+                    network_task_core_, network_task_priority_, (unsigned) network_task_stack_size_);
     }
-    handle_ssdp();
   }
 
   float get_setup_priority() const override {
@@ -164,46 +381,163 @@ class EmulatedRokuComponent : public Component {
   }
 
  protected:
-  std::string device_name_{"ESPHome Roku"};
-  uint16_t port_{8060};
+  std::string device_name_{"ESPHome Roku"};  // Owned by the serving task once the servers run
+  uint16_t port_{DEFAULT_PORT};
+  uint32_t keep_alive_timeout_{15000};
+  uint16_t max_requests_per_connection_{100};
+  uint32_t notify_interval_{SSDP_DEFAULT_NOTIFY_INTERVAL};
+  std::vector<uint32_t> notify_targets_;  // Unicast NOTIFY recipients, network byte order
   char uuid_[32];
   char usn_[32];
-  char local_ip_[16];
-  char mac_addr_[18];
-  WebServer *server_{nullptr};
-  WiFiUDP notify_udp_;
-  int mcast_sock_{-1};  // Raw socket for multicast SSDP
+  NetInterfaces interfaces_;  // Ethernet first, see read_net_interfaces(). Owned by the serving task
+  char wifi_mac_[18];
+  char ethernet_mac_[18];  // The WiFi MAC on boards without Ethernet, as a Roku stick reports
+  const char *network_type_{"wifi"};
+  EcpHttpServer *server_{nullptr};
+  // Bodies for GET / and /query/device-info, rebuilt only when their inputs change
+  TemplateResponsePtr device_description_;
+  TemplateResponsePtr device_info_;
+  SsdpResponder *ssdp_{nullptr};
+  bool ssdp_owner_{false};  // This device drives the shared responder
+  EcpStats ecp_stats_;
+  KeyTrace trace_;
+  uint32_t trace_id_{0};  // Trace record of the key request being handled, 0 if none
+  // Records covered by the /query/trace download in progress, see handle_trace()
+  uint32_t trace_dump_first_{0};
+  uint16_t trace_dump_count_{0};
+  uint32_t trace_dump_now_{0};
   CallbackManager<void(std::string, std::string)> key_press_callback_;
-  unsigned long last_notify_{0};
-  unsigned long last_igmp_refresh_{0};
-  bool ssdp_started_{false};
+  CallbackManager<void(RokuKeyEvent)> key_event_callback_;
+  CallbackManager<void(std::string, std::string)> text_input_callback_;
+  CallbackManager<void(std::string, std::string)> launch_callback_;
+  const char *apps_xml_{ROKU_APPS_TEMPLATE};
+  AppCatalog app_catalog_;
+  Ecp2Session ecp2_sessions_[EcpHttpServer::MAX_CONNECTIONS];  // By connection slot
   bool initialized_{false};
-  static const unsigned long NOTIFY_INTERVAL = 5000; // 5 seconds for discovery
-  static const unsigned long IGMP_REFRESH_INTERVAL = 60000; // Refresh IGMP membership every 60 seconds
+  // Network change detection on the main loop, see check_network()
+  uint32_t last_network_check_{0};
+  bool network_lost_{false};
+  NetInterfaces detected_;  // The main loop's copy of the interfaces
+  SpscQueue<NetInterfaces, NETWORK_QUEUE_SIZE> network_queue_;  // Changes on their way to the serving task
+  SpscQueue<QueuedDeviceName, RENAME_QUEUE_SIZE> rename_queue_;
+  // Optional FreeRTOS task that runs the SSDP and HTTP servers off the main loop
+  bool use_network_task_{false};
+  bool network_task_running_{false};
+  uint8_t network_task_core_{0};
+  uint8_t network_task_priority_{5};
+  uint32_t network_task_stack_size_{4096};
+  SpscQueue<QueuedKeyEvent, KEY_QUEUE_SIZE> key_queue_;
+  SpscQueue<QueuedTextEvent, TEXT_QUEUE_SIZE> text_queue_;
+  // Hold-to-repeat, runs on the main loop like the triggers it feeds
+  bool key_repeat_{false};
+  KeyRepeater key_repeater_;
+  TextAssembler text_assembler_;
+  HighFrequencyLoopRequester high_freq_;
+  volatile uint32_t last_io_{0};  // Written by whichever task polls the sockets
 
-  void start_servers() {
-    // Cache the IP and MAC now that WiFi is connected
-    // Use ESPHome network utilities which are more reliable than WiFi class
-    auto ip_addresses = network::get_ip_addresses();
-    if (!ip_addresses.empty() && ip_addresses[0].is_set()) {
-      snprintf(local_ip_, sizeof(local_ip_), "%s", ip_addresses[0].str().c_str());
-    } else {
-      // Fallback to WiFi class
-      IPAddress local = WiFi.localIP();
-      snprintf(local_ip_, sizeof(local_ip_), "%d.%d.%d.%d", local[0], local[1], local[2], local[3]);
+  // Waits up to timeout_ms for any socket to become ready, then services only
+  // what needs it. Timers (notify, IGMP refresh, pending replies, HTTP timeouts)
+  // run either way. Returns true if there was socket activity.
+  bool poll_network(uint32_t timeout_ms) {
+    bool http_ready = false;
+    bool ssdp_ready = false;
+    bool active = wait_for_io(timeout_ms, &http_ready, &ssdp_ready);
+    if (active) {
+      last_io_ = millis();
     }
+    NetInterfaces changed;
+    while (network_queue_.pop(changed)) {
+      apply_network_change(changed);
+    }
+    QueuedDeviceName renamed;
+    while (rename_queue_.pop(renamed)) {
+      device_name_ = renamed.name;
+      build_responses();
+    }
+    if (server_ != nullptr) {
+      server_->loop(http_ready);
+    }
+    if (ssdp_owner_) {
+      ssdp_->loop(ssdp_ready);
+    }
+    return active;
+  }
+
+  bool wait_for_io(uint32_t timeout_ms, bool *http_ready, bool *ssdp_ready) {
+    fd_set read_fds;
+    fd_set write_fds;
+    FD_ZERO(&read_fds);
+    FD_ZERO(&write_fds);
+    int max_fd = -1;
+    int ssdp_fd = ssdp_owner_ ? ssdp_->fd() : -1;
+    if (ssdp_fd >= 0) {
+      FD_SET(ssdp_fd, &read_fds);
+      max_fd = ssdp_fd;
+    }
+    if (server_ != nullptr) {
+      max_fd = server_->add_to_fd_sets(&read_fds, &write_fds, max_fd);
+    }
+    if (max_fd < 0) {
+      if (timeout_ms > 0) {
+        delay(timeout_ms);
+      }
+      return false;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    int ready = lwip_select(max_fd + 1, &read_fds, &write_fds, nullptr, &tv);
+    if (ready <= 0) {
+      return false;
+    }
+    *ssdp_ready = ssdp_fd >= 0 && FD_ISSET(ssdp_fd, &read_fds);
+    *http_ready = ready > (*ssdp_ready ? 1 : 0);
+    return true;
+  }
+
+  void start_network_task() {
+#ifdef USE_ESP32
+    BaseType_t created = xTaskCreatePinnedToCore(network_task, "emulated_roku", network_task_stack_size_, this,
+                                                 network_task_priority_, nullptr, network_task_core_);
+    if (created != pdPASS) {
+      ESP_LOGE("emulated_roku", "Failed to start network task, polling from the main loop instead");
+      return;
+    }
+    network_task_running_ = true;
+#endif
+  }
+
+#ifdef USE_ESP32
+  static void network_task(void *arg) {
+    auto *self = static_cast<EmulatedRokuComponent *>(arg);
+    for (;;) {
+      // Blocks in select() until there is traffic or a timer may be due
+      self->poll_network(NETWORK_TASK_WAIT_MS);
+    }
+  }
+#endif
+
+  void start_servers() {
+    // Cache the addresses and MACs now that the network is up, check_network() keeps them current
+    read_net_interfaces(&interfaces_);
+    detected_ = interfaces_;
+    update_identity();
+
+    char addresses[64];
+    interfaces_.describe(addresses, sizeof(addresses));
+    ESP_LOGI("emulated_roku", "Network connected, starting Emulated Roku on port %d at %s (MAC: %s)",
+             port_, addresses, network_type_[0] == 'e' ? ethernet_mac_ : wifi_mac_);
     
-    // Get MAC address
-    uint8_t mac[6];
-    esp_wifi_get_mac(WIFI_IF_STA, mac);
-    snprintf(mac_addr_, sizeof(mac_addr_), "%02X:%02X:%02X:%02X:%02X:%02X", 
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    
-    ESP_LOGI("emulated_roku", "WiFi connected, starting Emulated Roku on %s:%d (MAC: %s)", 
-             local_ip_, port_, mac_addr_);
-    
+    build_responses();
+
     // Create the web server
-    server_ = new WebServer(port_);
+    server_ = new EcpHttpServer(port_);
+    server_->set_keep_alive(keep_alive_timeout_, max_requests_per_connection_);
+    server_->on_response([this](uint8_t route, uint8_t connection, uint32_t elapsed_us) {
+      ecp_stats_.record_response(route, elapsed_us);
+      trace_.finish(connection, elapsed_us);
+    });
     
     setup_ssdp();
     setup_http_server();
@@ -211,358 +545,588 @@ class EmulatedRokuComponent : public Component {
     ESP_LOGI("emulated_roku", "Emulated Roku started successfully");
   }
 
-  void setup_ssdp() {
-    // Use raw BSD sockets for multicast - more reliable than WiFiUDP
-    create_multicast_socket();
+  // MACs and network type for device-info, from the current interfaces. The
+  // WiFi MAC is the station's even while only Ethernet is up.
+  void update_identity() {
+    uint8_t mac[6];
+#ifdef USE_HOST
+    get_mac_address_raw(mac);
+#else
+    esp_wifi_get_mac(WIFI_IF_STA, mac);
+#endif
+    format_mac(mac, wifi_mac_);
+    const NetInterface *ethernet = interfaces_.find_ethernet();
+    if (ethernet != nullptr) {
+      format_mac(ethernet->mac, ethernet_mac_);
+      network_type_ = "ethernet";
+    } else {
+      memcpy(ethernet_mac_, wifi_mac_, sizeof(ethernet_mac_));
+      network_type_ = "wifi";
+    }
+  }
+
+  static void format_mac(const uint8_t *mac, char *out) {
+    snprintf(out, 18, "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
   }
 
-  void create_multicast_socket() {
-    // Close existing socket if any
-    if (mcast_sock_ >= 0) {
-      lwip_close(mcast_sock_);
-      mcast_sock_ = -1;
+  // Runs on the main loop. Notices a lost connection, a new address (DHCP
+  // renewal, roaming to another network) and an interface coming or going
+  // (Ethernet plugged in next to WiFi) and queues a copy of the interfaces for
+  // whichever task serves, see apply_network_change(). Nothing the serving
+  // task reads is written here.
+  void check_network() {
+    uint32_t now = millis();
+    if (now - last_network_check_ < NETWORK_CHECK_INTERVAL) {
+      return;
     }
-    
-    // Create UDP socket
-    mcast_sock_ = lwip_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (mcast_sock_ < 0) {
-      ESP_LOGE("emulated_roku", "Failed to create multicast socket");
+    last_network_check_ = now;
+    if (!network::is_connected()) {
+      if (!network_lost_) {
+        ESP_LOGW("emulated_roku", "Network connection lost");
+        network_lost_ = true;
+      }
       return;
     }
-    
-    // Allow address reuse
-    int reuse = 1;
-    lwip_setsockopt(mcast_sock_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-    
-    // Bind to SSDP port on all interfaces (important: bind to INADDR_ANY, not local IP)
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(SSDP_PORT);
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);  // Bind to all interfaces
-    
-    if (lwip_bind(mcast_sock_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-      ESP_LOGE("emulated_roku", "Failed to bind multicast socket: %d", errno);
-      lwip_close(mcast_sock_);
-      mcast_sock_ = -1;
+
+    NetInterfaces current;
+    read_net_interfaces(&current);
+    bool moved = !current.same_addresses(detected_);
+    if (!moved && !network_lost_) {
       return;
     }
-    
-    // Join multicast group - this is the key part
-    struct ip_mreq mreq;
-    mreq.imr_multiaddr.s_addr = inet_addr("239.255.255.250");
-    mreq.imr_interface.s_addr = inet_addr(local_ip_);
-    
-    if (lwip_setsockopt(mcast_sock_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-      ESP_LOGE("emulated_roku", "Failed to join multicast group: %d", errno);
-      lwip_close(mcast_sock_);
-      mcast_sock_ = -1;
+    // With the queue full the change is noticed again on the next check
+    if (!network_queue_.push(current)) {
       return;
     }
-    
-    // Set socket to non-blocking
-    int flags = lwip_fcntl(mcast_sock_, F_GETFL, 0);
-    lwip_fcntl(mcast_sock_, F_SETFL, flags | O_NONBLOCK);
-    
-    ESP_LOGI("emulated_roku", "SSDP multicast socket created and joined group on %s", local_ip_);
-    ssdp_started_ = true;
-    last_igmp_refresh_ = millis();
-  }
-
-  void refresh_multicast_membership() {
-    // Periodically refresh IGMP membership to ensure we stay in the group
-    unsigned long now = millis();
-    if (now - last_igmp_refresh_ > IGMP_REFRESH_INTERVAL) {
-      if (mcast_sock_ >= 0) {
-        // Re-join the multicast group to refresh membership
-        struct ip_mreq mreq;
-        mreq.imr_multiaddr.s_addr = inet_addr("239.255.255.250");
-        mreq.imr_interface.s_addr = inet_addr(local_ip_);
-        
-        // Leave and rejoin to refresh
-        lwip_setsockopt(mcast_sock_, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
-        if (lwip_setsockopt(mcast_sock_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-          ESP_LOGW("emulated_roku", "IGMP refresh failed, recreating socket");
-          create_multicast_socket();
-        } else {
-          ESP_LOGD("emulated_roku", "Refreshed IGMP membership");
-        }
-      }
-      last_igmp_refresh_ = now;
+    char addresses[64];
+    current.describe(addresses, sizeof(addresses));
+    if (moved) {
+      char previous[64];
+      detected_.describe(previous, sizeof(previous));
+      ESP_LOGI("emulated_roku", "Addresses changed from %s to %s", previous, addresses);
+    } else {
+      ESP_LOGI("emulated_roku", "Network reconnected on %s", addresses);
+    }
+    detected_ = current;
+    network_lost_ = false;
+  }
+
+  // Runs on the serving task (or the main loop without one), which owns
+  // interfaces_ and everything built from it, so SSDP learns the new Locations
+  // right away instead of waiting for the old ones to expire.
+  void apply_network_change(const NetInterfaces &current) {
+    bool ethernet_changed = (current.find_ethernet() != nullptr) != (interfaces_.find_ethernet() != nullptr);
+    interfaces_ = current;
+    if (ethernet_changed) {
+      update_identity();
+      build_responses();
+    }
+    if (ssdp_owner_) {
+      ssdp_->handle_network_change(interfaces_);
+    }
+  }
+
+  void build_responses() {
+    // Only the field values are copied, the templates are sent from flash
+    const char *name = device_name_.c_str();
+    device_description_ = std::make_shared<TemplateResponse>("text/xml", ROKU_DEVICE_INFO_TEMPLATE,
+        std::initializer_list<const char *>{name, usn_, uuid_});
+    device_info_ = std::make_shared<TemplateResponse>("text/xml", ROKU_DEVICE_INFO_QUERY,
+        std::initializer_list<const char *>{
+            uuid_, usn_, usn_, usn_,  // udn, serial, device-id, advertising-id
+            wifi_mac_, ethernet_mac_, network_type_,
+            name, name, name, // friendly, default, user
+            "PowerOn"}); // power-mode - always report as on
+  }
+
+
+  void setup_ssdp() {
+    // One responder answers for every device on the board, the first to get
+    // here creates and drives it
+    if (global_ssdp_responder == nullptr) {
+      global_ssdp_responder = new SsdpResponder();
+    }
+    ssdp_ = global_ssdp_responder;
+    ssdp_->set_notify_interval(notify_interval_);
+    for (uint32_t target : notify_targets_) {
+      ssdp_->add_notify_target(target);
+    }
+    ssdp_->add_device(usn_, port_);
+    ssdp_owner_ = ssdp_->claim(this);
+    if (ssdp_owner_) {
+      ssdp_->begin(interfaces_);
     }
   }
 
   void setup_http_server() {
-    // Root - device description
-    server_->on("/", HTTP_GET, [this]() {
-      char buffer[1024];
-      snprintf(buffer, sizeof(buffer), ROKU_DEVICE_INFO_TEMPLATE, 
-               device_name_.c_str(), usn_, uuid_);
-      server_->send(200, "text/xml", buffer);
-    });
+    // Every request goes through the route table, there are no per-path handlers
+    server_->on_request([this]() { handle_request(); });
+    server_->on_websocket_message([this](char *data, size_t len) { handle_ecp2_message(data, len); });
 
-    // Key press handlers - using path prefix matching
-    server_->on("/keypress/", HTTP_POST, [this]() { handle_key_command("keypress"); });
-    server_->on("/keydown/", HTTP_POST, [this]() { handle_key_command("keydown"); });
-    server_->on("/keyup/", HTTP_POST, [this]() { handle_key_command("keyup"); });
-
-    // Launch app handler
-    server_->on("/launch/", HTTP_POST, [this]() {
-      String uri = server_->uri();
-      int idx = uri.lastIndexOf('/');
-      if (idx >= 0) {
-        String app_id = uri.substring(idx + 1);
-        ESP_LOGI("emulated_roku", "Launch: %s", app_id.c_str());
-      }
-      server_->send(200, "text/plain", "OK");
-    });
+    if (!server_->begin()) {
+      return;
+    }
+    ESP_LOGD("emulated_roku", "HTTP server started on port %d", port_);
+  }
 
-    // Query apps
-    server_->on("/query/apps", HTTP_GET, [this]() {
-      server_->send(200, "text/xml", ROKU_APPS_TEMPLATE);
-    });
+  void handle_request() {
+    uint32_t parsed_us = trace_.enabled() ? micros() : 0;
+    char *param;
+    EcpRoute route = match_ecp_route(server_->method(), server_->uri(), &param);
+    server_->tag_request(route);
+    if (parsed_us != 0) {
+      begin_trace(route == ECP_ROUTE_KEYPRESS || route == ECP_ROUTE_KEYDOWN || route == ECP_ROUTE_KEYUP, parsed_us,
+                  route, 0);
+    }
+    switch (route) {
+      case ECP_ROUTE_ROOT:
+        // Root - device description
+        server_->send(device_description_);
+        break;
+      case ECP_ROUTE_KEYPRESS:
+        handle_key_command(ROKU_KEY_EVENT_PRESS, param);
+        break;
+      case ECP_ROUTE_KEYDOWN:
+        handle_key_command(ROKU_KEY_EVENT_DOWN, param);
+        break;
+      case ECP_ROUTE_KEYUP:
+        handle_key_command(ROKU_KEY_EVENT_UP, param);
+        break;
+      case ECP_ROUTE_LAUNCH:
+        url_decode(param);
+        dispatch_text_event(TEXT_EVENT_LAUNCH, param);
+        server_->send(200, "text/plain", "OK");
+        break;
+      case ECP_ROUTE_APPS:
+        server_->send(200, "text/xml", apps_xml_);
+        break;
+      case ECP_ROUTE_ACTIVE_APP:
+        server_->send(200, "text/xml", ROKU_ACTIVE_APP_TEMPLATE);
+        break;
+      case ECP_ROUTE_DEVICE_INFO:
+        server_->send(device_info_);
+        break;
+      case ECP_ROUTE_ICON:
+        handle_icon(param);
+        break;
+      case ECP_ROUTE_SEARCH:
+        handle_search();
+        break;
+      case ECP_ROUTE_INPUT:
+        handle_input();
+        break;
+      case ECP_ROUTE_STATS:
+        // Request counts and latency histograms
+        server_->send_chunked(200, "text/xml",
+                              [this](uint16_t index, char *out, size_t len) { return write_stats(index, out, len); });
+        break;
+      case ECP_ROUTE_ECP_SESSION:
+        handle_ecp2_upgrade();
+        break;
+      case ECP_ROUTE_TRACE:
+        handle_trace();
+        break;
+      default:
+        // Unknown requests are acknowledged without doing anything
+        ESP_LOGV("emulated_roku", "HTTP %s %s", http_method_str(server_->method()), server_->uri());
+        server_->send(200, "text/plain", "OK");
+        break;
+    }
+    trace_id_ = 0;
+  }
 
-    // Query active app
-    server_->on("/query/active-app", HTTP_GET, [this]() {
-      server_->send(200, "text/xml", ROKU_ACTIVE_APP_TEMPLATE);
-    });
+  // Opens a trace record for a key request, or marks the connection's
+  // request as untraced so its response isn't taken for an earlier one's
+  void begin_trace(bool key, uint32_t parsed_us, uint8_t route, uint8_t flags) {
+    uint8_t connection = server_->connection_index();
+    if (!key) {
+      trace_.skip(connection);
+      return;
+    }
+    trace_id_ = trace_.begin(connection, server_->request_start(), parsed_us, route, flags);
+    trace_.stamp(trace_id_, TRACE_ROUTED, micros());
+  }
 
-    // Query device info
-    server_->on("/query/device-info", HTTP_GET, [this]() {
-      char buffer[3000];
-      snprintf(buffer, sizeof(buffer), ROKU_DEVICE_INFO_QUERY,
-               uuid_, usn_, usn_, usn_,  // udn, serial, device-id, advertising-id
-               mac_addr_, mac_addr_, // wifi-mac, ethernet-mac
-               device_name_.c_str(), device_name_.c_str(), device_name_.c_str(), // friendly, default, user
-               "PowerOn"); // power-mode - always report as on
-      server_->send(200, "text/xml", buffer);
+  // The ring as it is now, binary, for tools/roku_trace.py. Empty (a header
+  // with capacity 0) while tracing isn't configured.
+  // The window is kept in members so the writer only captures this and fits
+  // in std::function without allocating. A download started while another is
+  // running moves the window for both; roku_trace.py reads records by seq.
+  void handle_trace() {
+    trace_dump_first_ = trace_.oldest();
+    trace_dump_count_ = trace_.count();
+    trace_dump_now_ = micros();
+    server_->send_chunked(200, "application/octet-stream", [this](uint16_t index, char *out, size_t len) {
+      return trace_.write(index, trace_dump_first_, trace_dump_count_, trace_dump_now_, out, len);
     });
+  }
 
-    // App icon (return a placeholder)
-    server_->on("/query/icon/", HTTP_GET, [this]() {
-      // 1x1 transparent PNG
-      static const uint8_t placeholder_icon[] = {
-        0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D,
-        0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
-        0x08, 0x06, 0x00, 0x00, 0x00, 0x1F, 0x15, 0xC4, 0x89, 0x00, 0x00, 0x00,
-        0x0A, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9C, 0x63, 0x00, 0x01, 0x00, 0x00,
-        0x05, 0x00, 0x01, 0x0D, 0x0A, 0x2D, 0xB4, 0x00, 0x00, 0x00, 0x00, 0x49,
-        0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82
-      };
-      server_->send_P(200, "image/png", (const char*)placeholder_icon, sizeof(placeholder_icon));
-    });
+  void handle_key_command(RokuKeyEventType type, char *key) {
+    process_key_command(type, key);
+    server_->send(200, "text/plain", "OK");
+  }
 
-    // Input handler (for search/voice)
-    server_->on("/input", HTTP_POST, [this]() {
-      server_->send(200, "text/plain", "OK");
-    });
+  // Shared by the HTTP key routes and ECP-2 key messages
+  void process_key_command(RokuKeyEventType type, char *key) {
+    // Table lookup, Lit_ characters are decoded into the event without allocating
+    RokuKeyEvent event = parse_roku_key(type, key);
+    trace_.set_key(trace_id_, event.key, event.type);
+    
+    ESP_LOGD("emulated_roku", "%s: %s%s", roku_key_event_type_str(type),
+             event.key == ROKU_KEY_UNKNOWN ? key : roku_key_name(event.key), event.literal);
+    
+    // on_key_press gets the name exactly as sent, decoded where it lies in the
+    // request buffer; only bother if someone listens
+    if (this->key_press_callback_.size() > 0) {
+      url_decode(key);
+    }
+    if (trace_id_ != 0) {
+      trace_.stamp(trace_id_, TRACE_DECODED, micros());
+    }
+    dispatch_key_event(event, key);
+  }
 
-    // Search handler
-    server_->on("/search", HTTP_POST, [this]() {
-      server_->send(200, "text/plain", "OK");
-    });
+  // Upgrades /ecp-session and challenges the client, which has to
+  // authenticate before its keys are taken
+  void handle_ecp2_upgrade() {
+    if (!server_->accept_websocket(ECP2_PROTOCOL)) {
+      server_->send(400, "text/plain", "Bad Request");
+      return;
+    }
+    Ecp2Session &session = ecp2_sessions_[server_->connection_index()];
+    uint8_t nonce[16];
+    for (size_t i = 0; i < sizeof(nonce); i += 4) {
+      uint32_t r = random_uint32();
+      memcpy(nonce + i, &r, 4);
+    }
+    base64_encode_to(nonce, sizeof(nonce), session.challenge);
+    session.authenticated = false;
 
-    // Handle 404 - also check for key/launch patterns here
-    server_->onNotFound([this]() {
-      String uri = server_->uri();
-      HTTPMethod method = server_->method();
-      
-      // Log ALL requests for debugging
-      ESP_LOGI("emulated_roku", "HTTP %s %s", 
-               method == HTTP_GET ? "GET" : (method == HTTP_POST ? "POST" : "OTHER"),
-               uri.c_str());
-      
-      // Check for keypress/keydown/keyup patterns
-      if (uri.startsWith("/keypress/") || uri.startsWith("/keydown/") || uri.startsWith("/keyup/")) {
-        if (method == HTTP_POST) {
-          if (uri.startsWith("/keypress/")) {
-            handle_key_command("keypress");
-          } else if (uri.startsWith("/keydown/")) {
-            handle_key_command("keydown");
-          } else {
-            handle_key_command("keyup");
-          }
-          return;
-        }
-      }
-      
-      // Check for launch pattern
-      if (uri.startsWith("/launch/") && method == HTTP_POST) {
-        int idx = uri.lastIndexOf('/');
-        if (idx >= 0) {
-          String app_id = uri.substring(idx + 1);
-          ESP_LOGI("emulated_roku", "Launch: %s", app_id.c_str());
-        }
-        server_->send(200, "text/plain", "OK");
+    char notify[128];
+    uint32_t now = millis();
+    int len = snprintf(notify, sizeof(notify),
+                       "{\"notify\":\"authenticate\",\"param-challenge\":\"%s\",\"timestamp\":\"%u.%03u\"}",
+                       session.challenge, (unsigned) (now / 1000), (unsigned) (now % 1000));
+    server_->send_websocket_text(notify, len);
+    ESP_LOGD("emulated_roku", "ECP-2 session opened");
+  }
+
+  // One ECP-2 request, parsed in place in the receive buffer
+  void handle_ecp2_message(char *data, size_t len) {
+    uint32_t parsed_us = trace_.enabled() ? micros() : 0;
+    server_->tag_request(ECP_ROUTE_ECP_SESSION);
+    Ecp2Request request;
+    if (!parse_ecp2_request(data, len, &request) || request.request == nullptr) {
+      ESP_LOGV("emulated_roku", "ECP-2: ignoring a %u-byte message", (unsigned) len);
+      return;
+    }
+    Ecp2Session &session = ecp2_sessions_[server_->connection_index()];
+    const char *name = request.request;
+
+    if (strcmp(name, "authenticate") == 0) {
+      char expected[29];
+      ecp2_expected_response(session.challenge, expected);
+      if (request.param_response == nullptr || strcmp(request.param_response, expected) != 0) {
+        // Refused like a real Roku; the session stays open for another try
+        ESP_LOGW("emulated_roku", "ECP-2 client sent a wrong authentication response");
+        session.authenticated = false;
+        send_ecp2_response(request, 401, "Unauthorized");
         return;
       }
-      
-      // Check for icon pattern
-      if (uri.startsWith("/query/icon/") && method == HTTP_GET) {
-        static const uint8_t placeholder_icon[] = {
-          0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D,
-          0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
-          0x08, 0x06, 0x00, 0x00, 0x00, 0x1F, 0x15, 0xC4, 0x89, 0x00, 0x00, 0x00,
-          0x0A, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9C, 0x63, 0x00, 0x01, 0x00, 0x00,
-          0x05, 0x00, 0x01, 0x0D, 0x0A, 0x2D, 0xB4, 0x00, 0x00, 0x00, 0x00, 0x49,
-          0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82
-        };
-        server_->send_P(200, "image/png", (const char*)placeholder_icon, sizeof(placeholder_icon));
+      session.authenticated = true;
+      send_ecp2_response(request, 200, "OK");
+      return;
+    }
+
+    RokuKeyEventType type;
+    if (strcmp(name, "key-press") == 0) {
+      type = ROKU_KEY_EVENT_PRESS;
+    } else if (strcmp(name, "key-down") == 0) {
+      type = ROKU_KEY_EVENT_DOWN;
+    } else if (strcmp(name, "key-up") == 0) {
+      type = ROKU_KEY_EVENT_UP;
+    } else if (strcmp(name, "launch") == 0 && request.param_channel_id != nullptr) {
+      if (!session.authenticated) {
+        send_ecp2_response(request, 401, "Unauthorized");
         return;
       }
-      
-      // Unknown request
-      server_->send(200, "text/plain", "OK");
-    });
+      dispatch_text_event(TEXT_EVENT_LAUNCH, request.param_channel_id);
+      send_ecp2_response(request, 200, "OK");
+      return;
+    } else {
+      // Queries and the rest are acknowledged without doing anything, like
+      // unknown HTTP requests
+      ESP_LOGV("emulated_roku", "ECP-2 %s", name);
+      send_ecp2_response(request, 200, "OK");
+      return;
+    }
 
-    server_->begin();
-    ESP_LOGD("emulated_roku", "HTTP server started on port %d", port_);
+    if (!session.authenticated) {
+      send_ecp2_response(request, 401, "Unauthorized");
+    } else if (request.param_key == nullptr) {
+      send_ecp2_response(request, 400, "Bad Request");
+    } else {
+      if (parsed_us != 0) {
+        begin_trace(true, parsed_us, ECP_ROUTE_ECP_SESSION, TRACE_FLAG_ECP2);
+      }
+      process_key_command(type, request.param_key);
+      send_ecp2_response(request, 200, "OK");
+      trace_id_ = 0;
+    }
+  }
+
+  void send_ecp2_response(const Ecp2Request &request, int code, const char *status) {
+    char response[160];
+    int len = snprintf(response, sizeof(response),
+                       "{\"response\":\"%s\",\"response-code\":\"%d\",\"status\":\"%d\",\"status-msg\":\"%s\","
+                       "\"request-id\":\"%s\"}",
+                       request.request, code, code, status, request.request_id != nullptr ? request.request_id : "");
+    server_->send_websocket_text(response, len < (int) sizeof(response) ? len : sizeof(response) - 1);
   }
 
-  void handle_key_command(const char* type) {
-    String uri = server_->uri();
-    int idx = uri.lastIndexOf('/');
-    if (idx >= 0) {
-      String key = uri.substring(idx + 1);
-      // URL decode if needed (handle Lit_ keys for text input)
-      key = url_decode(key);
-      
-      ESP_LOGI("emulated_roku", "%s: %s", type, key.c_str());
-      
-      // Call the callback with type and key
-      this->key_press_callback_.call(std::string(type), std::string(key.c_str()));
+  void dispatch_key_event(const RokuKeyEvent &event, const char *name) {
+    if (!network_task_running_) {
+      fire_key_event(event, name, trace_id_);
+      return;
+    }
+    QueuedKeyEvent item;
+    item.event = event;
+    snprintf(item.name, sizeof(item.name), "%s", name);
+    item.trace_id = trace_id_;
+    trace_.add_flags(trace_id_, TRACE_FLAG_QUEUED);
+    if (!key_queue_.push(item)) {
+      ESP_LOGW("emulated_roku", "Key queue full, dropping %s", roku_key_name(event.key));
     }
-    server_->send(200, "text/plain", "OK");
   }
 
-  String url_decode(const String& str) {
-    String decoded;
-    char temp[] = "00";
-    for (size_t i = 0; i < str.length(); i++) {
-      if (str[i] == '%' && i + 2 < str.length()) {
-        temp[0] = str[i + 1];
-        temp[1] = str[i + 2];
-        decoded += (char)strtol(temp, nullptr, 16);
-        i += 2;
-      } else if (str[i] == '+') {
-        decoded += ' ';
-      } else {
-        decoded += str[i];
-      }
+  // Straight from flash; hubs revalidate with If-None-Match and get a 304
+  void handle_icon(char *id) {
+    url_decode(id);
+    const RokuApp *app = app_catalog_.find(id);
+    if (app != nullptr && app->icon != nullptr) {
+      server_->send_cached(app->icon_type, (const char *) app->icon, app->icon_len, app->icon_etag, ICON_MAX_AGE);
+    } else {
+      server_->send_cached("image/png", (const char *) PLACEHOLDER_ICON, sizeof(PLACEHOLDER_ICON),
+                           PLACEHOLDER_ICON_ETAG, ICON_MAX_AGE);
     }
-    return decoded;
   }
 
-  void handle_ssdp() {
-    if (!ssdp_started_ || mcast_sock_ < 0) {
-      // Try to recover SSDP if it failed to start
-      static unsigned long last_retry = 0;
-      unsigned long now = millis();
-      if (now - last_retry > 10000) {  // Retry every 10 seconds
-        ESP_LOGW("emulated_roku", "SSDP not started, attempting to initialize");
-        create_multicast_socket();
-        last_retry = now;
-      }
+  // Search, input and launch triggers run on the main loop like key triggers
+  void dispatch_text_event(TextEventSource source, const char *text) {
+    if (!network_task_running_) {
+      fire_text_event(source, text);
       return;
     }
-    
-    // Refresh IGMP membership periodically
-    refresh_multicast_membership();
-    
-    // Handle incoming SSDP requests using raw socket
-    char buffer[512];
-    struct sockaddr_in remote_addr;
-    socklen_t addr_len = sizeof(remote_addr);
-    
-    int len = lwip_recvfrom(mcast_sock_, buffer, sizeof(buffer) - 1, 0, 
-                            (struct sockaddr*)&remote_addr, &addr_len);
-    
-    if (len > 0) {
-      buffer[len] = '\0';
-      
-      // Check for M-SEARCH request
-      if (strstr(buffer, "M-SEARCH") != nullptr && 
-          (strstr(buffer, "roku:ecp") != nullptr || strstr(buffer, "ssdp:all") != nullptr)) {
-        char remote_ip[16];
-        inet_ntoa_r(remote_addr.sin_addr, remote_ip, sizeof(remote_ip));
-        uint16_t remote_port = ntohs(remote_addr.sin_port);
-        
-        ESP_LOGI("emulated_roku", "M-SEARCH from %s:%d", remote_ip, remote_port);
-        send_ssdp_response(remote_addr);
+    QueuedTextEvent item;
+    item.source = source;
+    snprintf(item.text, sizeof(item.text), "%s", text);
+    if (!text_queue_.push(item)) {
+      ESP_LOGW("emulated_roku", "Text queue full, dropping %s", text);
+    }
+  }
+
+  void fire_text_event(TextEventSource source, const char *text) {
+    switch (source) {
+      case TEXT_EVENT_SEARCH:
+        fire_text_input(text, "search");
+        break;
+      case TEXT_EVENT_INPUT:
+        fire_text_input(text, "input");
+        break;
+      case TEXT_EVENT_LAUNCH:
+        fire_launch(text);
+        break;
+    }
+  }
+
+  void fire_launch(const char *id) {
+    const RokuApp *app = app_catalog_.find(id);
+    if (app != nullptr) {
+      ESP_LOGD("emulated_roku", "Launch: %s (%s)", id, app->name);
+    } else {
+      ESP_LOGD("emulated_roku", "Launch: %s (not in the app catalog)", id);
+    }
+    uint32_t start = micros();
+    this->launch_callback_.call(std::string(id), std::string(app != nullptr ? app->name : ""));
+    ecp_stats_.key_dispatch.record(micros() - start);
+  }
+
+  // /search/browse?keyword=...: the keyword (or, without one, the title)
+  // becomes a text event
+  void handle_search() {
+    char *text = nullptr;
+    char *title = nullptr;
+    char *cursor = server_->query();
+    char *name;
+    char *value;
+    while (next_query_param(&cursor, &name, &value)) {
+      if (strcmp(name, "keyword") == 0) {
+        text = value;
+      } else if (strcmp(name, "title") == 0) {
+        title = value;
       }
     }
+    if (text == nullptr)
+      text = title;
+    if (text != nullptr && this->text_input_callback_.size() > 0) {
+      url_decode(text);
+      dispatch_text_event(TEXT_EVENT_SEARCH, text);
+    }
+    server_->send(200, "text/plain", "OK");
+  }
 
-    // Periodic SSDP notify
-    unsigned long now = millis();
-    if (now - last_notify_ > NOTIFY_INTERVAL || last_notify_ == 0) {
-      send_ssdp_notify();
-      last_notify_ = now;
-    }
-  }
-
-  void send_ssdp_response(struct sockaddr_in &remote_addr) {
-    // Match exact format from Python emulated_roku library that works with Harmony
-    char response[512];
-    snprintf(response, sizeof(response),
-      "HTTP/1.1 200 OK\r\n"
-      "Cache-Control: max-age = 300\r\n"
-      "ST: roku:ecp\r\n"
-      "SERVER: Roku/12.0.0 UPnP/1.0 Roku/12.0.0\r\n"
-      "Ext:\r\n"
-      "Location: http://%s:%d/\r\n"
-      "USN: uuid:roku:ecp:%s\r\n"
-      "\r\n",
-      local_ip_,
-      port_,
-      usn_
-    );
-
-    // Send response back to requester using the same socket
-    lwip_sendto(mcast_sock_, response, strlen(response), 0, 
-                (struct sockaddr*)&remote_addr, sizeof(remote_addr));
-    
-    char remote_ip[16];
-    inet_ntoa_r(remote_addr.sin_addr, remote_ip, sizeof(remote_ip));
-    ESP_LOGI("emulated_roku", "Sent SSDP response to %s:%d", 
-             remote_ip, ntohs(remote_addr.sin_port));
-  }
-
-  void send_ssdp_notify() {
-    // Match exact format from Python emulated_roku library
-    char notify[512];
-    snprintf(notify, sizeof(notify),
-      "NOTIFY * HTTP/1.1\r\n"
-      "HOST: 239.255.255.250:1900\r\n"
-      "Cache-Control: max-age = 300\r\n"
-      "NT: roku:ecp\r\n"
-      "NTS: ssdp:alive\r\n"
-      "SERVER: Roku/12.0.0 UPnP/1.0 Roku/12.0.0\r\n"
-      "Location: http://%s:%d/\r\n"
-      "USN: uuid:roku:ecp:%s\r\n"
-      "\r\n",
-      local_ip_,
-      port_,
-      usn_
-    );
-
-    // Send to standard SSDP multicast
-    notify_udp_.beginPacket(SSDP_MULTICAST_ADDR, SSDP_PORT);
-    notify_udp_.write((uint8_t*)notify, strlen(notify));
-    notify_udp_.endPacket();
+  // /input?name=value&...: each parameter becomes a text event "name=value"
+  void handle_input() {
+    char *cursor = server_->query();
+    char *name;
+    char *value;
+    while (next_query_param(&cursor, &name, &value)) {
+      if (this->text_input_callback_.size() == 0)
+        break;
+      url_decode(name);
+      url_decode(value);
+      char pair[TextAssembler::MAX_TEXT + 1];
+      snprintf(pair, sizeof(pair), "%s=%s", name, value);
+      dispatch_text_event(TEXT_EVENT_INPUT, pair);
+    }
+    server_->send(200, "text/plain", "OK");
+  }
+
+  void run_key_timers() {
+    uint32_t now = millis();
+    if (key_repeat_) {
+      auto fire = [this](const RokuKeyEvent &event, const char *name) { fire_key_event(event, name); };
+      key_repeater_.loop(now, fire, fire);
+    }
+    text_assembler_.loop(now, [this](const char *text) { fire_text_input(text, "keyboard"); });
+  }
+
+  void fire_text_input(const char *text, const char *source) {
+    ESP_LOGD("emulated_roku", "Text input (%s): %s", source, text);
+    uint32_t start = micros();
+    this->text_input_callback_.call(std::string(text), std::string(source));
+    ecp_stats_.key_dispatch.record(micros() - start);
+  }
+
+  void fire_key_event(const RokuKeyEvent &event, const char *name, uint32_t trace_id = 0) {
+    if (this->text_input_callback_.size() > 0) {
+      // Typed characters (and Backspace while there are some) go into the
+      // pending text; any other key delivers that text first, keeping order
+      auto deliver = [this](const char *text) { fire_text_input(text, "keyboard"); };
+      bool press = event.type == ROKU_KEY_EVENT_PRESS;
+      if (press && event.key == ROKU_KEY_LIT) {
+        text_assembler_.append(event.literal, millis(), deliver);
+        return;
+      }
+      if (press && event.key == ROKU_KEY_BACKSPACE && text_assembler_.backspace(millis())) {
+        return;
+      }
+      text_assembler_.flush(deliver);
+    }
     
-    // Also send to subnet broadcast as fallback for networks that block multicast
-    IPAddress broadcast(10, 1, 1, 255);
-    notify_udp_.beginPacket(broadcast, SSDP_PORT);
-    notify_udp_.write((uint8_t*)notify, strlen(notify));
-    notify_udp_.endPacket();
+    if (key_repeat_) {
+      // A second keydown for a key already held would restart nothing, drop it
+      if (event.type == ROKU_KEY_EVENT_DOWN && !key_repeater_.key_down(event, name, millis())) {
+        return;
+      }
+      if (event.type == ROKU_KEY_EVENT_UP) {
+        key_repeater_.key_up(event);
+      }
+    }
     
-    // Send directly to Harmony Hub (10.1.1.104)
-    IPAddress harmony_hub(10, 1, 1, 104);
-    notify_udp_.beginPacket(harmony_hub, SSDP_PORT);
-    notify_udp_.write((uint8_t*)notify, strlen(notify));
-    notify_udp_.endPacket();
+    uint32_t start = micros();
+    trace_.stamp(trace_id, TRACE_TRIGGERS_START, start);
+    this->key_event_callback_.call(event);
     
-    ESP_LOGD("emulated_roku", "Sent SSDP notify (multicast + broadcast + harmony)");
+    // The string callback needs owned copies, only build them if someone listens
+    if (this->key_press_callback_.size() > 0) {
+      this->key_press_callback_.call(std::string(roku_key_event_type_str(event.type)), std::string(name));
+    }
+    uint32_t end = micros();
+    ecp_stats_.key_dispatch.record(end - start);
+    trace_.stamp(trace_id, TRACE_TRIGGERS_END, end);
+  }
+
+  static int write_histogram(char *out, size_t len, const char *tag, const char *name, const LatencyHistogram &h) {
+    int pos = snprintf(out, len,
+                       "  <%s name=\"%s\" count=\"%u\" mean-us=\"%u\" p50-us=\"%u\" p90-us=\"%u\" p99-us=\"%u\" "
+                       "max-us=\"%u\" buckets=\"",
+                       tag, name, (unsigned) h.count(), (unsigned) h.mean_us(), (unsigned) h.percentile_us(50),
+                       (unsigned) h.percentile_us(90), (unsigned) h.percentile_us(99), (unsigned) h.max_us());
+    // Raw buckets let a collector merge histograms across devices
+    for (uint8_t i = 0; i < LatencyHistogram::BUCKETS && pos < (int) len; i++) {
+      pos += snprintf(out + pos, len - pos, i == 0 ? "%u" : ",%u", (unsigned) h.bucket(i));
+    }
+    if (pos < (int) len)
+      pos += snprintf(out + pos, len - pos, "\"/>\n");
+    return pos < (int) len ? pos : (int) len - 1;
+  }
+
+  // Renders /query/emulated-stats one element at a time, for send_chunked().
+  // Each piece reads the counters it prints when it is rendered.
+  int write_stats(uint16_t index, char *out, size_t len) const {
+    int n;
+    if (index == 0) {
+      n = snprintf(out, len,
+                   "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n<emulated-stats>\n  <uptime-ms>%u</uptime-ms>\n",
+                   (unsigned) millis());
+    } else if (index == 1) {
+      const HttpStats &http = server_->get_stats();
+      n = snprintf(out, len,
+                   "  <http connections=\"%u\" requests=\"%u\" reused=\"%u\" evicted=\"%u\" "
+                   "websocket-messages=\"%u\"/>\n",
+                   (unsigned) http.connections, (unsigned) http.requests, (unsigned) http.reused,
+                   (unsigned) http.evicted, (unsigned) http.websocket_messages);
+    } else if (index < 2 + ECP_ROUTE_COUNT) {
+      uint8_t route = index - 2;
+      // Skip routes that were never hit to keep the reply short
+      if (ecp_stats_.routes[route].requests == 0)
+        return 0;
+      return write_histogram(out, len, "route", ecp_route_name(route), ecp_stats_.routes[route].latency);
+    } else if (index == 2 + ECP_ROUTE_COUNT) {
+      return write_histogram(out, len, "dispatch", "key-triggers", ecp_stats_.key_dispatch);
+    } else if (index == 3 + ECP_ROUTE_COUNT) {
+      const SsdpStats &ssdp = get_ssdp_stats();
+      n = snprintf(out, len,
+                   "  <ssdp devices=\"%u\" received=\"%u\" searches=\"%u\" filtered=\"%u\" coalesced=\"%u\" "
+                   "answered=\"%u\"/>\n",
+                   (unsigned) (ssdp_ != nullptr ? ssdp_->device_count() : 0), (unsigned) ssdp.received,
+                   (unsigned) ssdp.searches, (unsigned) ssdp.filtered, (unsigned) ssdp.coalesced,
+                   (unsigned) ssdp.answered);
+    } else if (index == 4 + ECP_ROUTE_COUNT) {
+      const KeyRepeatStats &repeat = key_repeater_.get_stats();
+      n = snprintf(out, len, "  <key-repeat held=\"%u\" repeats=\"%u\" coalesced=\"%u\" auto-released=\"%u\"/>\n",
+                   (unsigned) key_repeater_.held_count(), (unsigned) repeat.repeats, (unsigned) repeat.coalesced,
+                   (unsigned) repeat.auto_released);
+    } else if (index == 5 + ECP_ROUTE_COUNT) {
+      const TextInputStats &text = text_assembler_.get_stats();
+      n = snprintf(out, len, "  <text-input characters=\"%u\" texts=\"%u\"/>\n", (unsigned) text.characters,
+                   (unsigned) text.texts);
+    } else if (index == 6 + ECP_ROUTE_COUNT) {
+      n = snprintf(out, len, "  <key-queue depth=\"%u\" high-water=\"%u\" overflows=\"%u\"/>\n</emulated-stats>\n",
+                   (unsigned) key_queue_.size(), (unsigned) key_queue_.high_water(),
+                   (unsigned) key_queue_.overflows());
+    } else {
+      return -1;
+    }
+    return n < (int) len ? n : (int) len - 1;
+  }
+
+  // Percent-decodes str in place; the result is never longer than the input
+  static void url_decode(char *str) {
+    char *out = str;
+    for (const char *in = str; *in != '\0'; in++) {
+      if (in[0] == '%' && in[1] != '\0' && in[2] != '\0') {
+        char hex[3] = {in[1], in[2], '\0'};
+        *out++ = (char) strtol(hex, nullptr, 16);
+        in += 2;
+      } else if (*in == '+') {
+        *out++ = ' ';
+      } else {
+        *out++ = *in;
+      }
+    }
+    *out = '\0';
   }
 };
 
@@ -575,5 +1139,30 @@ class KeyPressTrigger : public Trigger<std::string, std::string> {
   }
 };
 
+class KeyEventTrigger : public Trigger<RokuKeyEvent> {
+ public:
+  explicit KeyEventTrigger(EmulatedRokuComponent *parent) {
+    parent->add_on_key_event_callback([this](RokuKeyEvent event) { this->trigger(event); });
+  }
+};
+
+class LaunchTrigger : public Trigger<std::string, std::string> {
+ public:
+  explicit LaunchTrigger(EmulatedRokuComponent *parent) {
+    parent->add_on_launch_callback([this](std::string app_id, std::string app_name) {
+      this->trigger(app_id, app_name);
+    });
+  }
+};
+
+class TextInputTrigger : public Trigger<std::string, std::string> {
+ public:
+  explicit TextInputTrigger(EmulatedRokuComponent *parent) {
+    parent->add_on_text_input_callback([this](std::string text, std::string source) {
+      this->trigger(text, source);
+    });
+  }
+};
+
 }  // namespace emulated_roku
 }  // namespace esphome
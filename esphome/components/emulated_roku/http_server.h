@@ -0,0 +1,980 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "net_compat.h"
+#include "sha1.h"
+#include "template_response.h"
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
+#include <functional>
+#include <memory>
+
+namespace esphome {
+namespace emulated_roku {
+
+enum class HttpMethod : uint8_t { GET, POST, OTHER };
+
+inline const char *http_method_str(HttpMethod method) {
+  switch (method) {
+    case HttpMethod::GET:
+      return "GET";
+    case HttpMethod::POST:
+      return "POST";
+    default:
+      return "OTHER";
+  }
+}
+
+// Splits the next name=value pair off a query string, in place: the separators
+// are overwritten with NULs and *cursor moves past the pair. Values are left
+// percent-encoded. Returns false when the query string is used up.
+inline bool next_query_param(char **cursor, char **name, char **value) {
+  char *pair = *cursor;
+  if (*pair == '\0')
+    return false;
+  char *end = strchr(pair, '&');
+  if (end != nullptr) {
+    *end = '\0';
+    *cursor = end + 1;
+  } else {
+    *cursor = pair + strlen(pair);
+  }
+  char *equals = strchr(pair, '=');
+  if (equals != nullptr)
+    *equals = '\0';
+  *name = pair;
+  *value = equals != nullptr ? equals + 1 : pair + strlen(pair);
+  return true;
+}
+
+struct HttpStats {
+  uint32_t connections{0};  // Connections accepted
+  uint32_t requests{0};     // Responses completed
+  uint32_t reused{0};       // Requests served on an already used, kept-alive connection
+  uint32_t evicted{0};      // Idle kept-alive connections closed to make room for a new client
+  uint32_t websocket_messages{0};  // Text messages received on upgraded connections
+};
+
+// Non-blocking HTTP/1.1 server for the ECP API.
+//
+// Unlike Arduino's WebServer this never blocks the loop: the listener and all
+// client sockets are non-blocking, requests are parsed incrementally as bytes
+// arrive, and up to MAX_CONNECTIONS clients are in flight at once. Handlers
+// run from loop() and answer through send() for the request being dispatched,
+// so a slow or half-sent request never holds up the keypresses behind it.
+//
+// Connections are kept alive between requests, and pipelined requests already
+// sitting in the receive buffer are answered in order without another read.
+// A handler may also upgrade its connection to a WebSocket, after which
+// text messages go to the message handler instead.
+//
+// Serving a request never touches the heap: it is parsed in place in the
+// connection's receive buffer, and response headers and streamed bodies are
+// rendered into the connection's stream buffer, which serves as the request's
+// scratch arena.
+class EcpHttpServer {
+ public:
+  using Handler = std::function<void()>;
+  // Renders piece `index` of a streamed body into out (at most len bytes) and
+  // returns its length; empty pieces are skipped, -1 ends the body.
+  using BodyWriter = std::function<int(uint16_t index, char *out, size_t len)>;
+  // Called once per completed response with the request's tag, its connection
+  // slot (see connection_index()) and the time from accept (or, on a kept-alive
+  // connection, the request's first byte) until the last byte was handed to
+  // the socket.
+  using ResponseHook = std::function<void(uint8_t tag, uint8_t connection, uint32_t elapsed_us)>;
+  // Called with each complete text message on a WebSocket, NUL-terminated in
+  // the receive buffer. Answers go through send_websocket_text().
+  using MessageHandler = std::function<void(char *data, size_t len)>;
+
+  static const uint8_t MAX_CONNECTIONS = 4;
+  static const size_t RX_BUFFER_SIZE = 1024;
+  static const uint32_t REQUEST_TIMEOUT = 5000;  // Drop clients that stall mid-request
+  static const size_t STREAM_BUFFER_SIZE = 512;  // Per connection, for headers and streamed bodies
+  static const uint32_t WEBSOCKET_IDLE_TIMEOUT = 600000;  // A quiet WebSocket is closed after this
+
+  explicit EcpHttpServer(uint16_t port) : port_(port) {}
+
+  // Idle time before a kept-alive connection is closed, 0 disables keep-alive.
+  void set_keep_alive(uint32_t idle_timeout, uint16_t max_requests) {
+    keep_alive_timeout_ = idle_timeout;
+    max_requests_ = max_requests;
+  }
+
+  // Called for every complete request; it reads uri() and method(), answers
+  // through send() and may tag_request() for the response hook (default 0).
+  // Routing is up to the handler.
+  void on_request(Handler handler) { handler_ = std::move(handler); }
+  void on_response(ResponseHook hook) { response_hook_ = std::move(hook); }
+  void on_websocket_message(MessageHandler handler) { message_handler_ = std::move(handler); }
+
+  bool begin() {
+    listen_fd_ = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_fd_ < 0) {
+      ESP_LOGE("emulated_roku", "Failed to create HTTP socket: %d", errno);
+      return false;
+    }
+
+    int reuse = 1;
+    lwip_setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (lwip_bind(listen_fd_, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        lwip_listen(listen_fd_, MAX_CONNECTIONS) < 0) {
+      ESP_LOGE("emulated_roku", "Failed to listen on HTTP port %d: %d", port_, errno);
+      lwip_close(listen_fd_);
+      listen_fd_ = -1;
+      return false;
+    }
+
+    set_nonblocking_(listen_fd_);
+    return true;
+  }
+
+  // Adds the listener and every client socket to select() sets, clients with
+  // output still pending also wait for writability. Returns the highest fd.
+  // The listener is left out while no slot could take a connection, a pending
+  // one would otherwise keep select() returning at once.
+  int add_to_fd_sets(fd_set *read_fds, fd_set *write_fds, int max_fd) const {
+    if (listen_fd_ < 0)
+      return max_fd;
+    if (can_accept_()) {
+      FD_SET(listen_fd_, read_fds);
+      max_fd = listen_fd_ > max_fd ? listen_fd_ : max_fd;
+    }
+    for (const auto &conn : conns_) {
+      if (conn.fd < 0)
+        continue;
+      FD_SET(conn.fd, conn.out_count != 0 ? write_fds : read_fds);
+      max_fd = conn.fd > max_fd ? conn.fd : max_fd;
+    }
+    return max_fd;
+  }
+
+  // With io_ready false (select() saw nothing on our sockets) only timeouts are
+  // checked, so an idle server costs no socket calls.
+  void loop(bool io_ready = true) {
+    if (listen_fd_ < 0)
+      return;
+
+    if (io_ready)
+      accept_connections_();
+
+    for (auto &conn : conns_) {
+      if (conn.fd < 0)
+        continue;
+      if (io_ready)
+        service_(conn);
+      if (conn.fd < 0)
+        continue;
+
+      // Read after servicing, which may have just moved last_activity forward
+      uint32_t now = millis();
+
+      // Between requests a kept-alive connection gets the keep-alive timeout,
+      // a partially received request the (usually shorter) request timeout
+      uint32_t timeout = REQUEST_TIMEOUT;
+      if (is_idle_(conn))
+        timeout = conn.ws_open ? WEBSOCKET_IDLE_TIMEOUT : keep_alive_timeout_;
+      if (now - conn.last_activity > timeout) {
+        ESP_LOGV("emulated_roku", "HTTP client timed out");
+        close_(conn);
+      }
+    }
+  }
+
+  const HttpStats &get_stats() const { return stats_; }
+
+  // Accessors for the request currently being dispatched to a handler. The
+  // path lives in the receive buffer, the handler may decode it in place.
+  char *uri() const { return uri_; }
+  // Query string without the '?', empty if there is none. Also in the receive
+  // buffer, see next_query_param().
+  char *query() const { return query_; }
+  HttpMethod method() const { return method_; }
+  void tag_request(uint8_t tag) {
+    if (current_ != nullptr)
+      current_->tag = tag;
+  }
+  // Slot of the connection being dispatched, for handlers that keep state per
+  // connection (a WebSocket session). A new connection in a slot is always
+  // preceded by a new upgrade, where that state is reset.
+  uint8_t connection_index() const { return current_ != nullptr ? current_ - conns_ : 0; }
+  // micros() when the current request began, the start of response hook times
+  uint32_t request_start() const { return current_ != nullptr ? current_->request_start : 0; }
+
+  // Answers a GET carrying Upgrade: websocket with 101 Switching Protocols,
+  // agreeing to the given subprotocol. Returns false (nothing sent) if the
+  // request isn't a valid upgrade. Messages may be sent right after.
+  bool accept_websocket(const char *protocol) {
+    if (current_ == nullptr || current_->responded)
+      return false;
+    Connection &conn = *current_;
+    if (method_ != HttpMethod::GET || !conn.upgrade_websocket || conn.websocket_key_len == 0 ||
+        conn.websocket_key_len > 32)
+      return false;
+
+    char key[33];
+    memcpy(key, conn.websocket_key, conn.websocket_key_len);
+    key[conn.websocket_key_len] = '\0';
+    char accept[29];
+    sha1_base64(key, "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", accept);
+    int header_len = snprintf(conn.stream_buf, STREAM_BUFFER_SIZE,
+                              "HTTP/1.1 101 Switching Protocols\r\n"
+                              "Upgrade: websocket\r\n"
+                              "Connection: Upgrade\r\n"
+                              "Sec-WebSocket-Accept: %s\r\n"
+                              "Sec-WebSocket-Protocol: %s\r\n\r\n",
+                              accept, protocol);
+    conn.out_used = header_len;
+    queue_(conn, conn.stream_buf, header_len);
+    conn.websocket = true;
+    conn.keep_alive = true;
+    conn.responded = true;
+    return true;
+  }
+
+  // Queues a text message on the WebSocket being handled. Messages sent while
+  // handling one request or message share the stream buffer.
+  void send_websocket_text(const char *text, size_t len) {
+    if (current_ != nullptr && current_->websocket)
+      websocket_frame_(*current_, WS_OPCODE_TEXT, text, len);
+  }
+
+  // The body is sent from where it is, not copied, so it must stay valid until
+  // the response is out: string literals and other static data. Anything built
+  // per request goes through send_chunked() or a TemplateResponse.
+  void send(int code, const char *content_type, const char *body, size_t len) {
+    if (current_ == nullptr || current_->responded)
+      return;
+
+    Connection &conn = *current_;
+    int header_len = snprintf(conn.stream_buf, STREAM_BUFFER_SIZE,
+                              "HTTP/1.1 %d %s\r\n"
+                              "Content-Type: %s\r\n"
+                              "Content-Length: %u\r\n"
+                              "%s",
+                              code, status_text_(code), content_type, (unsigned) len, connection_header_(conn));
+    queue_(conn, conn.stream_buf, header_len);
+    queue_(conn, body, len);
+    conn.responded = true;
+  }
+  void send(int code, const char *content_type, const char *body) {
+    send(code, content_type, body, strlen(body));
+  }
+
+  // A static body (an icon in flash) with an ETag the client can revalidate
+  // against and a Cache-Control lifetime, or a bodiless 304 when the client
+  // already holds it. The body is sent in place, like send().
+  void send_cached(const char *content_type, const char *body, size_t len, const char *etag, uint32_t max_age) {
+    if (current_ == nullptr || current_->responded)
+      return;
+
+    Connection &conn = *current_;
+    bool not_modified = etag_matches_(conn, etag);
+    int header_len;
+    if (not_modified) {
+      header_len = snprintf(conn.stream_buf, STREAM_BUFFER_SIZE,
+                            "HTTP/1.1 304 Not Modified\r\n"
+                            "ETag: %s\r\n"
+                            "Cache-Control: max-age=%u\r\n"
+                            "%s",
+                            etag, (unsigned) max_age, connection_header_(conn));
+    } else {
+      header_len = snprintf(conn.stream_buf, STREAM_BUFFER_SIZE,
+                            "HTTP/1.1 200 OK\r\n"
+                            "Content-Type: %s\r\n"
+                            "Content-Length: %u\r\n"
+                            "ETag: %s\r\n"
+                            "Cache-Control: max-age=%u\r\n"
+                            "%s",
+                            content_type, (unsigned) len, etag, (unsigned) max_age, connection_header_(conn));
+    }
+    queue_(conn, conn.stream_buf, header_len);
+    if (!not_modified)
+      queue_(conn, body, len);
+    conn.responded = true;
+  }
+
+  // Streams a body of unknown length, rendered piece by piece into the
+  // connection's buffer as the socket drains. HTTP/1.1 clients get chunked
+  // transfer encoding, HTTP/1.0 clients a body ended by closing the connection.
+  void send_chunked(int code, const char *content_type, BodyWriter writer) {
+    if (current_ == nullptr || current_->responded)
+      return;
+
+    Connection &conn = *current_;
+    conn.chunked = conn.http11;
+    if (!conn.chunked)
+      conn.keep_alive = false;
+    int header_len = snprintf(conn.stream_buf, STREAM_BUFFER_SIZE,
+                              "HTTP/1.1 %d %s\r\n"
+                              "Content-Type: %s\r\n"
+                              "%s"
+                              "%s",
+                              code, status_text_(code), content_type,
+                              conn.chunked ? "Transfer-Encoding: chunked\r\n" : "", connection_header_(conn));
+    queue_(conn, conn.stream_buf, header_len);
+    conn.writer = std::move(writer);
+    conn.writer_index = 0;
+    conn.responded = true;
+  }
+
+  // Streams a template response through the connection's fixed buffer, or
+  // sends a bodiless 304 when the client already holds the current version.
+  // Headers and the start of the body share the first write.
+  void send(const TemplateResponsePtr &response) {
+    if (current_ == nullptr || current_->responded)
+      return;
+
+    Connection &conn = *current_;
+    const char *connection = connection_header_(conn);
+    size_t connection_len = strlen(connection);
+    char *buf = conn.stream_buf;
+    size_t len;
+    if (etag_matches_(conn, response->etag())) {
+      memcpy(buf, response->not_modified(), response->not_modified_len());
+      len = response->not_modified_len();
+      memcpy(buf + len, connection, connection_len);
+      len += connection_len;
+    } else {
+      memcpy(buf, response->head(), response->head_len());
+      len = response->head_len();
+      memcpy(buf + len, connection, connection_len);
+      len += connection_len;
+      conn.stream_offset = response->read(0, buf + len, STREAM_BUFFER_SIZE - len);
+      len += conn.stream_offset;
+      if (conn.stream_offset < response->size())
+        conn.stream = response;  // The rest goes out as the buffer drains
+    }
+    queue_(conn, buf, len);
+    conn.responded = true;
+  }
+
+ protected:
+  struct Slice {
+    const char *data;
+    size_t len;
+  };
+
+  static const uint8_t MAX_SLICES = 4;
+  static const uint8_t WS_OPCODE_TEXT = 0x1;
+  static const uint8_t WS_OPCODE_CLOSE = 0x8;
+  static const uint8_t WS_OPCODE_PING = 0x9;
+  static const uint8_t WS_OPCODE_PONG = 0xA;
+  static const size_t CHUNK_PREFIX_SIZE = 5;  // Hex length of a stream buffer sized chunk plus CRLF
+  static constexpr const char *CONNECTION_CLOSE = "Connection: close\r\n\r\n";
+  static constexpr const char *CONNECTION_KEEP_ALIVE = "Connection: keep-alive\r\n\r\n";
+
+  struct Connection {
+    int fd{-1};
+    uint32_t last_activity{0};
+    uint16_t served{0};  // Requests answered on this connection so far
+    uint32_t request_start{0};  // micros() when the request at the front of rx began
+    uint32_t received_at{0};    // micros() of the last read, the start of any pipelined request
+    size_t rx_len{0};
+    // Parse state of the request at the front of rx
+    size_t scan_pos{0};    // Where the search for the end of the header block resumes
+    size_t header_len{0};  // Non-zero once the full header block has arrived
+    size_t content_length{0};
+    bool bad_length{false};  // Content-Length that isn't a plain decimal number
+    bool keep_alive{false};
+    bool http11{false};
+    const char *if_none_match{nullptr};  // Points into rx, not NUL-terminated
+    size_t if_none_match_len{0};
+    bool upgrade_websocket{false};
+    const char *websocket_key{nullptr};  // Points into rx, not NUL-terminated
+    size_t websocket_key_len{0};
+    // WebSocket state: accepted (101 queued), open (upgrade request done,
+    // rx holds frames), closing (close frame queued, drop after flushing)
+    bool websocket{false};
+    bool ws_open{false};
+    bool ws_closing{false};
+    bool responded{false};
+    uint8_t tag{0};
+    // Pending output: slices of stream_buf or static data, sent in order, then
+    // whatever is left of a streamed template response or writer body
+    Slice out[MAX_SLICES];
+    uint8_t out_count{0};
+    uint8_t out_index{0};
+    size_t out_offset{0};
+    size_t out_used{0};  // Bytes of stream_buf taken by queued WebSocket output
+    TemplateResponsePtr stream;
+    size_t stream_offset{0};  // Body bytes already copied into stream_buf
+    BodyWriter writer;
+    uint16_t writer_index{0};  // Next piece to ask the writer for
+    bool chunked{false};
+    char rx[RX_BUFFER_SIZE];
+    char stream_buf[STREAM_BUFFER_SIZE];
+  };
+
+  static void set_nonblocking_(int fd) {
+    int flags = lwip_fcntl(fd, F_GETFL, 0);
+    lwip_fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  }
+
+  static const char *status_text_(int code) {
+    switch (code) {
+      case 200:
+        return "OK";
+      case 400:
+        return "Bad Request";
+      case 404:
+        return "Not Found";
+      case 413:
+        return "Payload Too Large";
+      default:
+        return "Internal Server Error";
+    }
+  }
+
+  static bool is_idle_(const Connection &conn) {
+    return conn.served > 0 && conn.rx_len == 0 && conn.out_count == 0;
+  }
+
+  // A connection can be taken when a slot is free or an idle one can make way
+  bool can_accept_() const {
+    for (const auto &conn : conns_) {
+      if (conn.fd < 0 || is_idle_(conn))
+        return true;
+    }
+    return false;
+  }
+
+  const char *connection_header_(Connection &conn) {
+    if (conn.served + 1 >= max_requests_)
+      conn.keep_alive = false;
+    return conn.keep_alive ? CONNECTION_KEEP_ALIVE : CONNECTION_CLOSE;
+  }
+
+  void accept_connections_() {
+    for (;;) {
+      Connection *slot = nullptr;
+      Connection *idle = nullptr;
+      for (auto &conn : conns_) {
+        if (conn.fd < 0) {
+          slot = &conn;
+          break;
+        }
+        // Idle HTTP connections make way before an open WebSocket does
+        if (is_idle_(conn) && (idle == nullptr || (idle->ws_open && !conn.ws_open) ||
+                               (idle->ws_open == conn.ws_open && conn.last_activity < idle->last_activity)))
+          idle = &conn;
+      }
+      // With every slot taken only an idle kept-alive connection may make way;
+      // otherwise further clients wait in the listen backlog
+      if (slot == nullptr && idle == nullptr)
+        return;
+
+      struct sockaddr_in addr;
+      socklen_t addr_len = sizeof(addr);
+      int fd = lwip_accept(listen_fd_, (struct sockaddr *) &addr, &addr_len);
+      if (fd < 0)
+        return;
+
+      if (slot == nullptr) {
+        close_(*idle);
+        stats_.evicted++;
+        slot = idle;
+      }
+
+      set_nonblocking_(fd);
+      int nodelay = 1;
+      lwip_setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+      slot->fd = fd;
+      slot->served = 0;
+      slot->rx_len = 0;
+      slot->last_activity = millis();
+      slot->request_start = micros();
+      reset_request_(*slot);
+      stats_.connections++;
+    }
+  }
+
+  void reset_request_(Connection &conn) {
+    conn.scan_pos = 0;
+    conn.header_len = 0;
+    conn.content_length = 0;
+    conn.bad_length = false;
+    conn.keep_alive = false;
+    conn.http11 = false;
+    conn.if_none_match = nullptr;
+    conn.if_none_match_len = 0;
+    conn.upgrade_websocket = false;
+    conn.websocket_key = nullptr;
+    conn.websocket_key_len = 0;
+    conn.responded = false;
+    conn.tag = 0;
+    conn.stream.reset();
+    conn.stream_offset = 0;
+    conn.writer = nullptr;
+    conn.writer_index = 0;
+    conn.chunked = false;
+    conn.out_count = 0;
+    conn.out_index = 0;
+    conn.out_offset = 0;
+  }
+
+  void close_(Connection &conn) {
+    lwip_close(conn.fd);
+    conn.fd = -1;
+    conn.rx_len = 0;
+    conn.websocket = false;
+    conn.ws_open = false;
+    conn.ws_closing = false;
+    reset_request_(conn);
+  }
+
+  static void queue_(Connection &conn, const char *data, size_t len) {
+    if (conn.out_count < MAX_SLICES && len > 0)
+      conn.out[conn.out_count++] = Slice{data, len};
+  }
+
+  static bool etag_matches_(const Connection &conn, const char *etag) {
+    const char *value = conn.if_none_match;
+    size_t len = conn.if_none_match_len;
+    size_t etag_len = strlen(etag);
+    if (value == nullptr)
+      return false;
+    if (len == 1 && *value == '*')
+      return true;
+    // The header may carry a list of (possibly weak) tags; any match counts
+    for (size_t i = 0; i + etag_len <= len; i++) {
+      if (memcmp(value + i, etag, etag_len) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  // Moves a connection forward as far as it can go without blocking: sends
+  // pending output, answers every complete request already buffered, and
+  // reads from the socket at most once.
+  void service_(Connection &conn) {
+    bool received = false;
+    while (conn.fd >= 0) {
+      if (conn.out_count != 0) {
+        if (!flush_(conn))
+          return;  // Socket buffer full, or the connection was closed
+        if (conn.ws_open) {
+          finish_websocket_output_(conn);
+        } else {
+          finish_response_(conn);
+        }
+        continue;
+      }
+      if (conn.ws_open ? process_websocket_frame_(conn) : process_buffered_(conn))
+        continue;
+      if (received || !receive_(conn))
+        return;
+      received = true;
+    }
+  }
+
+  bool receive_(Connection &conn) {
+    int len = lwip_recv(conn.fd, conn.rx + conn.rx_len, RX_BUFFER_SIZE - 1 - conn.rx_len, 0);
+    if (len == 0 || (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      close_(conn);
+      return false;
+    }
+    if (len < 0)
+      return false;
+
+    conn.received_at = micros();
+    if (conn.rx_len == 0 && conn.served > 0)
+      conn.request_start = conn.received_at;  // First byte of the next request on a kept-alive connection
+    conn.rx_len += len;
+    conn.last_activity = millis();
+    return true;
+  }
+
+  // Dispatches the request at the front of rx if it is complete. Returns true
+  // if a response (possibly an error) was queued.
+  bool process_buffered_(Connection &conn) {
+    if (conn.rx_len == 0)
+      return false;
+    if (conn.header_len == 0 && !parse_header_(conn)) {
+      if (conn.rx_len < RX_BUFFER_SIZE - 1)
+        return false;
+      respond_error_(conn, 413);
+      return true;
+    }
+    if (conn.bad_length) {
+      respond_error_(conn, 400);
+      return true;
+    }
+    // header_len is at most RX_BUFFER_SIZE - 1, so this can't wrap
+    if (conn.content_length > RX_BUFFER_SIZE - 1 - conn.header_len) {
+      respond_error_(conn, 413);
+      return true;
+    }
+    if (conn.rx_len < conn.header_len + conn.content_length)
+      return false;  // Body still in flight
+
+    dispatch_(conn);
+    return true;
+  }
+
+  // Scans only the bytes that arrived since the last call. Returns true once the
+  // header block is complete and its fields have been extracted.
+  bool parse_header_(Connection &conn) {
+    size_t i = conn.scan_pos > 3 ? conn.scan_pos - 3 : 0;
+    for (; i + 4 <= conn.rx_len; i++) {
+      if (memcmp(conn.rx + i, "\r\n\r\n", 4) == 0) {
+        conn.header_len = i + 4;
+        break;
+      }
+    }
+    conn.scan_pos = conn.rx_len;
+    if (conn.header_len == 0)
+      return false;
+
+    // HTTP/1.1 keeps the connection open unless asked not to, HTTP/1.0 the reverse
+    const char *end = conn.rx + conn.header_len;
+    const char *line = static_cast<const char *>(memchr(conn.rx, '\n', conn.header_len));
+    conn.http11 = line - conn.rx >= 9 && memcmp(line - 9, "HTTP/1.1", 8) == 0;
+    conn.keep_alive = keep_alive_timeout_ > 0 && conn.http11;
+
+    // Header lines start after the request line
+    while (line != nullptr && ++line < end) {
+      if (strncasecmp(line, "Content-Length:", 15) == 0) {
+        conn.bad_length = !parse_content_length_(line + 15, end, &conn.content_length);
+      } else if (strncasecmp(line, "Connection:", 11) == 0) {
+        const char *value = line + 11;
+        while (*value == ' ')
+          value++;
+        if (strncasecmp(value, "close", 5) == 0) {
+          conn.keep_alive = false;
+        } else if (strncasecmp(value, "keep-alive", 10) == 0) {
+          conn.keep_alive = keep_alive_timeout_ > 0;
+        }
+      } else if (strncasecmp(line, "Upgrade:", 8) == 0) {
+        const char *value = line + 8;
+        while (*value == ' ')
+          value++;
+        conn.upgrade_websocket = strncasecmp(value, "websocket", 9) == 0;
+      } else if (strncasecmp(line, "Sec-WebSocket-Key:", 18) == 0) {
+        const char *value = line + 18;
+        while (*value == ' ')
+          value++;
+        const char *value_end = static_cast<const char *>(memchr(value, '\r', end - value));
+        conn.websocket_key = value;
+        conn.websocket_key_len = value_end != nullptr ? value_end - value : 0;
+      } else if (strncasecmp(line, "If-None-Match:", 14) == 0) {
+        const char *value = line + 14;
+        while (*value == ' ')
+          value++;
+        const char *value_end = static_cast<const char *>(memchr(value, '\r', end - value));
+        conn.if_none_match = value;
+        conn.if_none_match_len = value_end != nullptr ? value_end - value : 0;
+      }
+      line = static_cast<const char *>(memchr(line, '\n', end - line));
+    }
+    return true;
+  }
+
+  // Digits only, so "-1" or "0x10" can't slip through strtoul(). Anything
+  // longer than the receive buffer is reported as just too long for it.
+  static bool parse_content_length_(const char *value, const char *end, size_t *length) {
+    while (value < end && *value == ' ')
+      value++;
+    size_t n = 0;
+    const char *digits = value;
+    for (; value < end && *value >= '0' && *value <= '9'; value++) {
+      if (n <= RX_BUFFER_SIZE)
+        n = n * 10 + (*value - '0');
+    }
+    while (value < end && *value == ' ')
+      value++;
+    if (value == digits || value >= end || *value != '\r')
+      return false;
+    *length = n;
+    return true;
+  }
+
+  void dispatch_(Connection &conn) {
+    // Request line: METHOD SP URI SP VERSION, split in place. Pipelined requests
+    // may follow in rx; only the bytes of this request are modified.
+    char *line_end = static_cast<char *>(memchr(conn.rx, '\r', conn.header_len));
+    char *sp = line_end != nullptr ? static_cast<char *>(memchr(conn.rx, ' ', line_end - conn.rx)) : nullptr;
+    char *uri = sp != nullptr ? sp + 1 : nullptr;
+    char *uri_end = uri != nullptr ? static_cast<char *>(memchr(uri, ' ', line_end - uri)) : nullptr;
+    if (uri_end == nullptr || *uri != '/') {
+      respond_error_(conn, 400);
+      return;
+    }
+    *uri_end = '\0';
+    char *query = strchr(uri, '?');
+    if (query != nullptr) {
+      *query++ = '\0';
+    } else {
+      query = uri_end;
+    }
+
+    size_t method_len = sp - conn.rx;
+    if (method_len == 3 && memcmp(conn.rx, "GET", 3) == 0) {
+      method_ = HttpMethod::GET;
+    } else if (method_len == 4 && memcmp(conn.rx, "POST", 4) == 0) {
+      method_ = HttpMethod::POST;
+    } else {
+      method_ = HttpMethod::OTHER;
+    }
+    uri_ = uri;
+    query_ = query;
+    current_ = &conn;
+
+    if (handler_) {
+      handler_();
+    }
+    if (!conn.responded) {
+      send(500, "text/plain", "No response");
+    }
+
+    current_ = nullptr;
+    uri_ = nullptr;
+    query_ = nullptr;
+  }
+
+  void respond_error_(Connection &conn, int code) {
+    // The stream can't be trusted past a malformed request, so don't keep it
+    conn.keep_alive = false;
+    conn.header_len = conn.rx_len;
+    conn.content_length = 0;
+    current_ = &conn;
+    send(code, "text/plain", status_text_(code));
+    current_ = nullptr;
+  }
+
+  // Returns true once every queued slice, and all of a streamed body, has been
+  // handed to the socket.
+  bool flush_(Connection &conn) {
+    while (conn.out_index < conn.out_count || refill_(conn)) {
+      const Slice &slice = conn.out[conn.out_index];
+      int sent = ::lwip_send(conn.fd, slice.data + conn.out_offset, slice.len - conn.out_offset, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+          close_(conn);
+        return false;
+      }
+      conn.out_offset += sent;
+      conn.last_activity = millis();
+      if (conn.out_offset == slice.len) {
+        conn.out_index++;
+        conn.out_offset = 0;
+      }
+    }
+    return true;
+  }
+
+  // Renders the next piece of a streamed body into the connection's buffer.
+  static bool refill_(Connection &conn) {
+    if (conn.writer)
+      return refill_writer_(conn);
+    if (conn.stream == nullptr || conn.stream_offset >= conn.stream->size())
+      return false;
+    size_t len = conn.stream->read(conn.stream_offset, conn.stream_buf, STREAM_BUFFER_SIZE);
+    conn.stream_offset += len;
+    conn.out_count = 0;
+    conn.out_index = 0;
+    queue_(conn, conn.stream_buf, len);
+    return true;
+  }
+
+  // The piece is rendered after room for the chunk size, which is then written
+  // right-aligned in front of it.
+  static bool refill_writer_(Connection &conn) {
+    char *piece = conn.stream_buf + CHUNK_PREFIX_SIZE;
+    int len;
+    do {
+      len = conn.writer(conn.writer_index++, piece, STREAM_BUFFER_SIZE - CHUNK_PREFIX_SIZE - 2);
+    } while (len == 0);
+    conn.out_count = 0;
+    conn.out_index = 0;
+    if (len < 0) {
+      conn.writer = nullptr;
+      if (conn.chunked)
+        queue_(conn, "0\r\n\r\n", 5);
+      return conn.chunked;
+    }
+    if (!conn.chunked) {
+      queue_(conn, piece, len);
+      return true;
+    }
+    char prefix[CHUNK_PREFIX_SIZE + 1];
+    int prefix_len = snprintf(prefix, sizeof(prefix), "%x\r\n", (unsigned) len);
+    memcpy(piece - prefix_len, prefix, prefix_len);
+    memcpy(piece + len, "\r\n", 2);
+    queue_(conn, piece - prefix_len, prefix_len + len + 2);
+    return true;
+  }
+
+  // Closes the connection or, when kept alive, drops the answered request from
+  // rx so the next pipelined request moves to the front.
+  void finish_response_(Connection &conn) {
+    if (response_hook_)
+      response_hook_(conn.tag, &conn - conns_, micros() - conn.request_start);
+    stats_.requests++;
+    if (conn.served > 0)
+      stats_.reused++;
+    conn.served++;
+
+    if (!conn.keep_alive) {
+      close_(conn);
+      return;
+    }
+    size_t consumed = conn.header_len + conn.content_length;
+    memmove(conn.rx, conn.rx + consumed, conn.rx_len - consumed);
+    conn.rx_len -= consumed;
+    conn.request_start = conn.received_at;
+    reset_request_(conn);
+    if (conn.websocket) {
+      // The upgrade request is done, whatever follows in rx are frames
+      conn.ws_open = true;
+      conn.out_used = 0;
+    }
+  }
+
+  // Handles the frame at the front of rx if it is complete, then drops it
+  // from rx; answers are queued in stream_buf. Returns true if a frame was
+  // consumed. Clients must mask their frames; fragmented and binary messages
+  // aren't used by ECP and end the session.
+  bool process_websocket_frame_(Connection &conn) {
+    if (conn.ws_closing || conn.rx_len < 2)
+      return false;
+    uint8_t *frame = reinterpret_cast<uint8_t *>(conn.rx);
+    bool fin = frame[0] & 0x80;
+    uint8_t opcode = frame[0] & 0x0F;
+    size_t len = frame[1] & 0x7F;
+    size_t header_len = 2;
+    if (len == 126) {
+      if (conn.rx_len < 4)
+        return false;
+      len = (size_t) frame[2] << 8 | frame[3];
+      header_len = 4;
+    }
+    if (!(frame[1] & 0x80) || len == 127) {
+      fail_websocket_(conn, 1002);
+      return true;
+    }
+    header_len += 4;  // Masking key
+    if (header_len + len > RX_BUFFER_SIZE - 1) {
+      fail_websocket_(conn, 1009);
+      return true;
+    }
+    if (conn.rx_len < header_len + len)
+      return false;  // Rest of the frame still in flight
+
+    char *payload = conn.rx + header_len;
+    const uint8_t *mask = frame + header_len - 4;
+    for (size_t i = 0; i < len; i++)
+      payload[i] ^= mask[i & 3];
+    conn.request_start = conn.received_at;
+
+    if (opcode == WS_OPCODE_TEXT && fin) {
+      stats_.websocket_messages++;
+      // NUL-terminate for the handler; the byte belongs to the next frame
+      char saved = payload[len];
+      payload[len] = '\0';
+      current_ = &conn;
+      conn.tag = 0;
+      if (message_handler_)
+        message_handler_(payload, len);
+      current_ = nullptr;
+      payload[len] = saved;
+    } else if (opcode == WS_OPCODE_PING) {
+      websocket_frame_(conn, WS_OPCODE_PONG, payload, len);
+    } else if (opcode == WS_OPCODE_CLOSE) {
+      // Echo the status code and close once that is out
+      websocket_frame_(conn, WS_OPCODE_CLOSE, payload, len < 2 ? len : 2);
+      conn.ws_closing = true;
+    } else if (opcode != WS_OPCODE_PONG) {
+      fail_websocket_(conn, 1003);
+      return true;
+    }
+
+    size_t consumed = header_len + len;
+    memmove(conn.rx, conn.rx + consumed, conn.rx_len - consumed);
+    conn.rx_len -= consumed;
+    if (conn.ws_closing && conn.out_count == 0)
+      close_(conn);
+    return true;
+  }
+
+  // Sends a close frame with the given status and drops the connection once
+  // it is out; anything still in rx is discarded.
+  void fail_websocket_(Connection &conn, uint16_t code) {
+    ESP_LOGV("emulated_roku", "Closing WebSocket: %u", code);
+    uint8_t status[2] = {(uint8_t) (code >> 8), (uint8_t) code};
+    websocket_frame_(conn, WS_OPCODE_CLOSE, (const char *) status, sizeof(status));
+    conn.ws_closing = true;
+    conn.rx_len = 0;
+    if (conn.out_count == 0)
+      close_(conn);
+  }
+
+  // Appends an unmasked frame to the output in stream_buf, extending the last
+  // queued slice when the two are contiguous.
+  void websocket_frame_(Connection &conn, uint8_t opcode, const char *data, size_t len) {
+    size_t header_len = len < 126 ? 2 : 4;
+    if (conn.out_used + header_len + len > STREAM_BUFFER_SIZE) {
+      ESP_LOGW("emulated_roku", "WebSocket message of %u bytes dropped", (unsigned) len);
+      return;
+    }
+    char *frame = conn.stream_buf + conn.out_used;
+    frame[0] = (char) (0x80 | opcode);
+    if (header_len == 2) {
+      frame[1] = (char) len;
+    } else {
+      frame[1] = 126;
+      frame[2] = (char) (len >> 8);
+      frame[3] = (char) len;
+    }
+    memcpy(frame + header_len, data, len);
+    size_t frame_len = header_len + len;
+    conn.out_used += frame_len;
+
+    Slice *last = conn.out_count > 0 ? &conn.out[conn.out_count - 1] : nullptr;
+    if (last != nullptr && last->data + last->len == frame) {
+      last->len += frame_len;
+    } else {
+      queue_(conn, frame, frame_len);
+    }
+  }
+
+  void finish_websocket_output_(Connection &conn) {
+    if (conn.tag != 0 && response_hook_)
+      response_hook_(conn.tag, &conn - conns_, micros() - conn.request_start);
+    conn.tag = 0;
+    conn.out_count = 0;
+    conn.out_index = 0;
+    conn.out_offset = 0;
+    conn.out_used = 0;
+    if (conn.ws_closing)
+      close_(conn);
+  }
+
+  uint16_t port_;
+  int listen_fd_{-1};
+  uint32_t keep_alive_timeout_{15000};
+  uint16_t max_requests_{100};
+  Connection conns_[MAX_CONNECTIONS];
+  Handler handler_;
+  ResponseHook response_hook_;
+  MessageHandler message_handler_;
+  Connection *current_{nullptr};
+  char *uri_{nullptr};
+  char *query_{nullptr};
+  HttpMethod method_{HttpMethod::OTHER};
+  HttpStats stats_;
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
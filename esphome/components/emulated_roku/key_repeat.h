@@ -0,0 +1,146 @@
+#pragma once
+
+#include "keys.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace esphome {
+namespace emulated_roku {
+
+struct KeyRepeatStats {
+  uint32_t repeats{0};         // Repeat events generated
+  uint32_t coalesced{0};       // Repeats skipped because the loop fell behind, or duplicate keydowns dropped
+  uint32_t auto_released{0};   // Keys released because their keyup never came
+};
+
+// Turns a keydown ... keyup pair into a stream of repeat events, the way a
+// held button on a real remote behaves: the first repeat after `delay`, then
+// one every `interval` until the key is released.
+//
+// Held keys live in a small fixed table. Times are passed in by the caller
+// (millis() on the device), so the engine has no clock of its own. Repeats are
+// scheduled from their deadlines, not from when loop() happened to run, so
+// they don't drift with loop timing; if the caller falls behind by more than
+// an interval the missed repeats collapse into one instead of arriving as a
+// burst. A key whose keyup is lost is released `release_timeout` after its
+// last keydown; hubs that resend keydown while a button is held keep it alive.
+class KeyRepeater {
+ public:
+  static const uint8_t MAX_HELD_KEYS = 4;
+
+  void configure(uint32_t delay, uint32_t interval, uint32_t release_timeout) {
+    delay_ = delay;
+    interval_ = interval > 0 ? interval : 1;
+    release_timeout_ = release_timeout;
+  }
+
+  // Starts repeating a key. Returns false if the key is already held: a
+  // duplicate keydown, which only restarts the release timeout and should not
+  // be passed on. With the table full the key is still passed on but doesn't
+  // repeat, as are unrecognised keys.
+  bool key_down(const RokuKeyEvent &event, const char *name, uint32_t now) {
+    if (event.key == ROKU_KEY_UNKNOWN)
+      return true;
+    HeldKey *free_slot = nullptr;
+    for (auto &held : held_) {
+      if (!held.in_use) {
+        if (free_slot == nullptr)
+          free_slot = &held;
+      } else if (same_key_(held.event, event)) {
+        held.last_keydown = now;
+        stats_.coalesced++;
+        return false;
+      }
+    }
+    if (free_slot == nullptr)
+      return true;
+    free_slot->in_use = true;
+    free_slot->event = event;
+    free_slot->event.type = ROKU_KEY_EVENT_REPEAT;
+    snprintf(free_slot->name, sizeof(free_slot->name), "%s", name);
+    free_slot->last_keydown = now;
+    free_slot->next_repeat = now + delay_;
+    held_count_++;
+    return true;
+  }
+
+  // Stops repeating a key. Returns false if it wasn't held.
+  bool key_up(const RokuKeyEvent &event) {
+    for (auto &held : held_) {
+      if (held.in_use && same_key_(held.event, event)) {
+        release_(held);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Generates the repeats due by now through on_repeat(event, name), and
+  // releases keys held past the timeout through on_release(event, name), with
+  // the event type set to ROKU_KEY_EVENT_UP.
+  template<typename RepeatFn, typename ReleaseFn> void loop(uint32_t now, RepeatFn on_repeat, ReleaseFn on_release) {
+    if (held_count_ == 0)
+      return;
+    for (auto &held : held_) {
+      if (!held.in_use)
+        continue;
+      if (release_timeout_ > 0 && now - held.last_keydown >= release_timeout_) {
+        RokuKeyEvent event = held.event;
+        event.type = ROKU_KEY_EVENT_UP;
+        stats_.auto_released++;
+        release_(held);
+        on_release(event, held.name);
+        continue;
+      }
+      int32_t late = (int32_t) (now - held.next_repeat);
+      if (late < 0)
+        continue;
+      if ((uint32_t) late >= interval_) {
+        // Missed one or more deadlines entirely: send one repeat now and
+        // resume the cadence from here
+        stats_.coalesced += late / interval_;
+        held.next_repeat = now + interval_;
+      } else {
+        held.next_repeat += interval_;
+      }
+      stats_.repeats++;
+      on_repeat(held.event, held.name);
+    }
+  }
+
+  uint32_t get_delay() const { return delay_; }
+  uint32_t get_interval() const { return interval_; }
+  uint32_t get_release_timeout() const { return release_timeout_; }
+  bool active() const { return held_count_ > 0; }
+  uint8_t held_count() const { return held_count_; }
+  const KeyRepeatStats &get_stats() const { return stats_; }
+
+ protected:
+  struct HeldKey {
+    bool in_use{false};
+    RokuKeyEvent event;  // As generated for repeats, type ROKU_KEY_EVENT_REPEAT
+    char name[24];       // Name for on_key_press, as received with the keydown
+    uint32_t last_keydown;  // The release timeout runs from here
+    uint32_t next_repeat;
+  };
+
+  static bool same_key_(const RokuKeyEvent &a, const RokuKeyEvent &b) {
+    return a.key == b.key && (a.key != ROKU_KEY_LIT || strcmp(a.literal, b.literal) == 0);
+  }
+
+  void release_(HeldKey &held) {
+    held.in_use = false;
+    held_count_--;
+  }
+
+  HeldKey held_[MAX_HELD_KEYS];
+  uint8_t held_count_{0};
+  uint32_t delay_{500};
+  uint32_t interval_{100};
+  uint32_t release_timeout_{10000};
+  KeyRepeatStats stats_;
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace esphome {
+namespace emulated_roku {
+
+// Keys defined by the Roku ECP. Values index ROKU_KEY_NAMES (offset by one).
+enum RokuKey : uint8_t {
+  ROKU_KEY_UNKNOWN = 0,
+  ROKU_KEY_HOME,
+  ROKU_KEY_REV,
+  ROKU_KEY_FWD,
+  ROKU_KEY_PLAY,
+  ROKU_KEY_SELECT,
+  ROKU_KEY_LEFT,
+  ROKU_KEY_RIGHT,
+  ROKU_KEY_DOWN,
+  ROKU_KEY_UP,
+  ROKU_KEY_BACK,
+  ROKU_KEY_INSTANT_REPLAY,
+  ROKU_KEY_INFO,
+  ROKU_KEY_BACKSPACE,
+  ROKU_KEY_SEARCH,
+  ROKU_KEY_ENTER,
+  ROKU_KEY_FIND_REMOTE,
+  ROKU_KEY_VOLUME_DOWN,
+  ROKU_KEY_VOLUME_MUTE,
+  ROKU_KEY_VOLUME_UP,
+  ROKU_KEY_POWER,
+  ROKU_KEY_POWER_OFF,
+  ROKU_KEY_POWER_ON,
+  ROKU_KEY_CHANNEL_UP,
+  ROKU_KEY_CHANNEL_DOWN,
+  ROKU_KEY_INPUT_TUNER,
+  ROKU_KEY_INPUT_HDMI1,
+  ROKU_KEY_INPUT_HDMI2,
+  ROKU_KEY_INPUT_HDMI3,
+  ROKU_KEY_INPUT_HDMI4,
+  ROKU_KEY_INPUT_AV1,
+  ROKU_KEY_LIT,  // Lit_<char> text entry, the character is in RokuKeyEvent::literal
+};
+
+enum RokuKeyEventType : uint8_t {
+  ROKU_KEY_EVENT_PRESS = 0,
+  ROKU_KEY_EVENT_DOWN,
+  ROKU_KEY_EVENT_UP,
+  ROKU_KEY_EVENT_REPEAT,  // Generated while a key is held, see key_repeat.h
+};
+
+// A decoded key command. Plain data, passed by value to triggers without allocating.
+struct RokuKeyEvent {
+  RokuKeyEventType type;
+  RokuKey key;
+  char literal[5];  // UTF-8 character for ROKU_KEY_LIT, NUL-terminated
+};
+
+static constexpr const char *ROKU_KEY_NAMES[] = {
+    "Home",
+    "Rev",
+    "Fwd",
+    "Play",
+    "Select",
+    "Left",
+    "Right",
+    "Down",
+    "Up",
+    "Back",
+    "InstantReplay",
+    "Info",
+    "Backspace",
+    "Search",
+    "Enter",
+    "FindRemote",
+    "VolumeDown",
+    "VolumeMute",
+    "VolumeUp",
+    "Power",
+    "PowerOff",
+    "PowerOn",
+    "ChannelUp",
+    "ChannelDown",
+    "InputTuner",
+    "InputHDMI1",
+    "InputHDMI2",
+    "InputHDMI3",
+    "InputHDMI4",
+    "InputAV1",
+};
+static constexpr uint8_t ROKU_KEY_COUNT = sizeof(ROKU_KEY_NAMES) / sizeof(ROKU_KEY_NAMES[0]);
+static_assert(ROKU_KEY_COUNT + 1 == ROKU_KEY_LIT, "ROKU_KEY_NAMES must match the RokuKey enum");
+
+inline const char *roku_key_name(RokuKey key) {
+  if (key == ROKU_KEY_LIT)
+    return "Lit_";
+  if (key == ROKU_KEY_UNKNOWN || key > ROKU_KEY_COUNT)
+    return "Unknown";
+  return ROKU_KEY_NAMES[key - 1];
+}
+
+inline const char *roku_key_event_type_str(RokuKeyEventType type) {
+  switch (type) {
+    case ROKU_KEY_EVENT_DOWN:
+      return "keydown";
+    case ROKU_KEY_EVENT_UP:
+      return "keyup";
+    case ROKU_KEY_EVENT_REPEAT:
+      return "keyrepeat";
+    default:
+      return "keypress";
+  }
+}
+
+// Perfect hash over the key names, found at compile time. Names are folded to
+// lower case so lookups are case-insensitive like a real Roku.
+static constexpr uint8_t ROKU_KEY_TABLE_SIZE = 128;
+
+constexpr uint32_t roku_key_hash(const char *name, size_t len, uint32_t seed) {
+  uint32_t hash = 2166136261UL ^ seed;
+  for (size_t i = 0; i < len; i++) {
+    char c = name[i];
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619UL;
+  }
+  return hash;
+}
+
+constexpr size_t roku_key_strlen(const char *str) {
+  size_t len = 0;
+  while (str[len] != '\0')
+    len++;
+  return len;
+}
+
+constexpr bool roku_key_seed_is_perfect(uint32_t seed) {
+  bool used[ROKU_KEY_TABLE_SIZE] = {};
+  for (uint8_t i = 0; i < ROKU_KEY_COUNT; i++) {
+    const char *name = ROKU_KEY_NAMES[i];
+    uint32_t slot = roku_key_hash(name, roku_key_strlen(name), seed) % ROKU_KEY_TABLE_SIZE;
+    if (used[slot])
+      return false;
+    used[slot] = true;
+  }
+  return true;
+}
+
+constexpr uint32_t roku_key_find_seed() {
+  uint32_t seed = 0;
+  while (!roku_key_seed_is_perfect(seed))
+    seed++;
+  return seed;
+}
+
+static constexpr uint32_t ROKU_KEY_HASH_SEED = roku_key_find_seed();
+
+struct RokuKeyTable {
+  uint8_t slots[ROKU_KEY_TABLE_SIZE];  // RokuKey, or ROKU_KEY_UNKNOWN for empty slots
+};
+
+constexpr RokuKeyTable roku_key_build_table() {
+  RokuKeyTable table{};
+  for (uint8_t i = 0; i < ROKU_KEY_COUNT; i++) {
+    const char *name = ROKU_KEY_NAMES[i];
+    table.slots[roku_key_hash(name, roku_key_strlen(name), ROKU_KEY_HASH_SEED) % ROKU_KEY_TABLE_SIZE] = i + 1;
+  }
+  return table;
+}
+
+static constexpr RokuKeyTable ROKU_KEY_TABLE = roku_key_build_table();
+
+// Looks up a key name (not URL-encoded) in one hash and one compare.
+inline RokuKey roku_key_from_name(const char *name, size_t len) {
+  uint8_t key = ROKU_KEY_TABLE.slots[roku_key_hash(name, len, ROKU_KEY_HASH_SEED) % ROKU_KEY_TABLE_SIZE];
+  if (key == ROKU_KEY_UNKNOWN)
+    return ROKU_KEY_UNKNOWN;
+  const char *candidate = ROKU_KEY_NAMES[key - 1];
+  if (strncasecmp(candidate, name, len) != 0 || candidate[len] != '\0')
+    return ROKU_KEY_UNKNOWN;
+  return static_cast<RokuKey>(key);
+}
+
+// Decodes the last path segment of /keypress/<key> and friends into an event.
+// Lit_ characters are percent-decoded straight into the event.
+inline RokuKeyEvent parse_roku_key(RokuKeyEventType type, const char *segment) {
+  RokuKeyEvent event{type, ROKU_KEY_UNKNOWN, {}};
+  if (strncmp(segment, "Lit_", 4) == 0) {
+    event.key = ROKU_KEY_LIT;
+    size_t out = 0;
+    for (const char *p = segment + 4; *p != '\0' && out < sizeof(event.literal) - 1; p++) {
+      if (p[0] == '%' && p[1] != '\0' && p[2] != '\0') {
+        char hex[3] = {p[1], p[2], '\0'};
+        event.literal[out++] = static_cast<char>(strtol(hex, nullptr, 16));
+        p += 2;
+      } else if (*p == '+') {
+        event.literal[out++] = ' ';
+      } else {
+        event.literal[out++] = *p;
+      }
+    }
+    return event;
+  }
+  event.key = roku_key_from_name(segment, strlen(segment));
+  return event;
+}
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,55 @@
+#pragma once
+
+// The component talks to the lwIP BSD socket API directly. On the ESP32 that
+// is lwIP itself; on the host platform the same calls map one to one onto
+// POSIX sockets, so the servers run unmodified against the loopback interface.
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_HOST
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+
+inline int lwip_socket(int domain, int type, int protocol) { return ::socket(domain, type, protocol); }
+inline int lwip_bind(int s, const struct sockaddr *name, socklen_t namelen) { return ::bind(s, name, namelen); }
+inline int lwip_listen(int s, int backlog) { return ::listen(s, backlog); }
+inline int lwip_accept(int s, struct sockaddr *addr, socklen_t *addrlen) { return ::accept(s, addr, addrlen); }
+inline int lwip_close(int s) { return ::close(s); }
+inline int lwip_fcntl(int s, int cmd, int val) { return ::fcntl(s, cmd, val); }
+inline int lwip_setsockopt(int s, int level, int optname, const void *optval, socklen_t optlen) {
+  return ::setsockopt(s, level, optname, optval, optlen);
+}
+inline ssize_t lwip_recv(int s, void *mem, size_t len, int flags) { return ::recv(s, mem, len, flags); }
+inline ssize_t lwip_recvfrom(int s, void *mem, size_t len, int flags, struct sockaddr *from, socklen_t *fromlen) {
+  return ::recvfrom(s, mem, len, flags, from, fromlen);
+}
+inline ssize_t lwip_send(int s, const void *data, size_t size, int flags) { return ::send(s, data, size, flags); }
+inline ssize_t lwip_sendto(int s, const void *data, size_t size, int flags, const struct sockaddr *to,
+                           socklen_t tolen) {
+  return ::sendto(s, data, size, flags, to, tolen);
+}
+inline int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset, struct timeval *timeout) {
+  return ::select(maxfdp1, readset, writeset, exceptset, timeout);
+}
+
+inline char *inet_ntoa_r(struct in_addr addr, char *buf, int buflen) {
+  return const_cast<char *>(inet_ntop(AF_INET, &addr, buf, buflen));
+}
+
+#else
+
+#include <lwip/igmp.h>
+#include <lwip/ip_addr.h>
+#include <lwip/tcpip.h>
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+
+#endif
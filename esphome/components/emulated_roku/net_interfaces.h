@@ -0,0 +1,176 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+#include "esphome/components/network/util.h"
+#include "net_compat.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#ifdef USE_HOST
+#include <linux/if_packet.h>
+#include <net/if.h>
+#else
+#include <WiFi.h>
+#include <esp_netif.h>
+#include <esp_wifi.h>
+#endif
+
+namespace esphome {
+namespace emulated_roku {
+
+// Enough for the boards this is used on: Ethernet plus WiFi station
+static const uint8_t MAX_NET_INTERFACES = 2;
+
+// An IPv4 interface the device can be reached on
+struct NetInterface {
+  uint32_t addr;     // Network byte order
+  uint32_t netmask;  // Network byte order, 0 if unknown
+  uint8_t mac[6];
+  bool ethernet;
+  char ip[16];
+};
+
+// The interfaces that are up, Ethernet first. SSDP answers and announces on
+// each of them with its own Location.
+struct NetInterfaces {
+  NetInterface list[MAX_NET_INTERFACES];
+  uint8_t count{0};
+
+  void add(uint32_t addr, uint32_t netmask, const uint8_t *mac, bool ethernet) {
+    if (count == MAX_NET_INTERFACES || addr == 0)
+      return;
+    NetInterface &iface = list[count++];
+    iface.addr = addr;
+    iface.netmask = netmask;
+    memcpy(iface.mac, mac, sizeof(iface.mac));
+    iface.ethernet = ethernet;
+    struct in_addr in;
+    in.s_addr = addr;
+    inet_ntoa_r(in, iface.ip, sizeof(iface.ip));
+  }
+
+  // Same addresses and netmasks in the same order
+  bool same_addresses(const NetInterfaces &other) const {
+    if (count != other.count)
+      return false;
+    for (uint8_t i = 0; i < count; i++) {
+      if (list[i].addr != other.list[i].addr || list[i].netmask != other.list[i].netmask)
+        return false;
+    }
+    return true;
+  }
+
+  bool contains(uint32_t addr) const {
+    for (uint8_t i = 0; i < count; i++) {
+      if (list[i].addr == addr)
+        return true;
+    }
+    return false;
+  }
+
+  // The interface whose subnet holds addr, or the first one for hosts that
+  // aren't on any local subnet
+  uint8_t route(uint32_t addr) const {
+    for (uint8_t i = 0; i < count; i++) {
+      if (list[i].netmask != 0 && (addr & list[i].netmask) == (list[i].addr & list[i].netmask))
+        return i;
+    }
+    return 0;
+  }
+
+  const NetInterface *find_ethernet() const {
+    for (uint8_t i = 0; i < count; i++) {
+      if (list[i].ethernet)
+        return &list[i];
+    }
+    return nullptr;
+  }
+
+  // "192.168.1.20 (ethernet), 192.168.1.21 (wifi)", for the log
+  void describe(char *out, size_t len) const {
+    size_t pos = 0;
+    out[0] = '\0';
+    for (uint8_t i = 0; i < count && pos < len; i++) {
+      pos += snprintf(out + pos, len - pos, "%s%s (%s)", i == 0 ? "" : ", ", list[i].ip,
+                      list[i].ethernet ? "ethernet" : "wifi");
+    }
+  }
+};
+
+#ifdef USE_HOST
+// Every IPv4 interface that is up, skipping loopback unless it is all there
+// is. Wireless interfaces (wl*) count as WiFi, everything else as Ethernet.
+inline void read_net_interfaces(NetInterfaces *out) {
+  out->count = 0;
+  struct ifaddrs *addrs;
+  if (getifaddrs(&addrs) != 0) {
+    return;
+  }
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    for (struct ifaddrs *ifa = addrs; ifa != nullptr; ifa = ifa->ifa_next) {
+      if (ifa->ifa_addr == nullptr || ifa->ifa_addr->sa_family != AF_INET || !(ifa->ifa_flags & IFF_UP) ||
+          (ifa->ifa_flags & IFF_LOOPBACK)) {
+        continue;
+      }
+      // Ethernet on the first pass, WiFi on the second
+      bool ethernet = strncmp(ifa->ifa_name, "wl", 2) != 0;
+      if (ethernet != (pass == 0)) {
+        continue;
+      }
+      uint8_t mac[6] = {};
+      for (struct ifaddrs *link = addrs; link != nullptr; link = link->ifa_next) {
+        if (link->ifa_addr != nullptr && link->ifa_addr->sa_family == AF_PACKET &&
+            strcmp(link->ifa_name, ifa->ifa_name) == 0) {
+          memcpy(mac, ((struct sockaddr_ll *) link->ifa_addr)->sll_addr, sizeof(mac));
+          break;
+        }
+      }
+      uint32_t netmask = ifa->ifa_netmask != nullptr ? ((struct sockaddr_in *) ifa->ifa_netmask)->sin_addr.s_addr : 0;
+      out->add(((struct sockaddr_in *) ifa->ifa_addr)->sin_addr.s_addr, netmask, mac, ethernet);
+    }
+  }
+  freeifaddrs(addrs);
+  if (out->count == 0) {
+    uint8_t mac[6];
+    get_mac_address_raw(mac);
+    out->add(inet_addr("127.0.0.1"), inet_addr("255.0.0.0"), mac, false);
+  }
+}
+#else
+// The default esp_netif interfaces, as created by ESPHome's ethernet and wifi
+// components. Falls back to the address ESPHome reports (or the WiFi class)
+// on setups that name their interfaces differently.
+inline void read_net_interfaces(NetInterfaces *out) {
+  static const struct {
+    const char *key;
+    bool ethernet;
+  } NETIF_KEYS[] = {{"ETH_DEF", true}, {"WIFI_STA_DEF", false}};
+
+  out->count = 0;
+  for (const auto &entry : NETIF_KEYS) {
+    esp_netif_t *netif = esp_netif_get_handle_from_ifkey(entry.key);
+    esp_netif_ip_info_t info;
+    if (netif == nullptr || !esp_netif_is_netif_up(netif) || esp_netif_get_ip_info(netif, &info) != ESP_OK) {
+      continue;
+    }
+    uint8_t mac[6] = {};
+    esp_netif_get_mac(netif, mac);
+    out->add(info.ip.addr, info.netmask.addr, mac, entry.ethernet);
+  }
+  if (out->count != 0) {
+    return;
+  }
+
+  uint8_t mac[6];
+  esp_wifi_get_mac(WIFI_IF_STA, mac);
+  auto ip_addresses = network::get_ip_addresses();
+  if (!ip_addresses.empty() && ip_addresses[0].is_set()) {
+    out->add(inet_addr(ip_addresses[0].str().c_str()), (uint32_t) WiFi.subnetMask(), mac, false);
+  } else {
+    out->add((uint32_t) WiFi.localIP(), (uint32_t) WiFi.subnetMask(), mac, false);
+  }
+}
+#endif
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "http_server.h"
+#include "stats.h"
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace emulated_roku {
+
+constexpr uint8_t const_strlen(const char *str) { return *str == '\0' ? 0 : 1 + const_strlen(str + 1); }
+
+// One path segment in the ECP route tree. A node either ends the path, takes
+// the rest of it as a parameter (the key name, app id, ...), or has children
+// for the next segment. A node with children may also end the path itself.
+struct RouteNode {
+  constexpr RouteNode(const char *segment, HttpMethod method, EcpRoute route, bool param,
+                      const RouteNode *children = nullptr, uint8_t child_count = 0)
+      : segment(segment), len(const_strlen(segment)), method(method), route(route), param(param),
+        children(children), child_count(child_count) {}
+
+  const char *segment;
+  uint8_t len;
+  HttpMethod method;
+  EcpRoute route;
+  bool param;
+  const RouteNode *children;
+  uint8_t child_count;
+};
+
+static constexpr RouteNode ECP_QUERY_ROUTES[] = {
+    {"apps", HttpMethod::GET, ECP_ROUTE_APPS, false},
+    {"active-app", HttpMethod::GET, ECP_ROUTE_ACTIVE_APP, false},
+    {"device-info", HttpMethod::GET, ECP_ROUTE_DEVICE_INFO, false},
+    {"icon", HttpMethod::GET, ECP_ROUTE_ICON, true},
+    {"emulated-stats", HttpMethod::GET, ECP_ROUTE_STATS, false},
+    {"trace", HttpMethod::GET, ECP_ROUTE_TRACE, false},
+};
+
+static constexpr RouteNode ECP_SEARCH_ROUTES[] = {
+    {"browse", HttpMethod::POST, ECP_ROUTE_SEARCH, false},
+};
+
+static constexpr RouteNode ECP_ROUTES[] = {
+    {"", HttpMethod::GET, ECP_ROUTE_ROOT, false},
+    {"keypress", HttpMethod::POST, ECP_ROUTE_KEYPRESS, true},
+    {"keydown", HttpMethod::POST, ECP_ROUTE_KEYDOWN, true},
+    {"keyup", HttpMethod::POST, ECP_ROUTE_KEYUP, true},
+    {"launch", HttpMethod::POST, ECP_ROUTE_LAUNCH, true},
+    {"input", HttpMethod::POST, ECP_ROUTE_INPUT, false},
+    {"search", HttpMethod::POST, ECP_ROUTE_SEARCH, false, ECP_SEARCH_ROUTES,
+     sizeof(ECP_SEARCH_ROUTES) / sizeof(ECP_SEARCH_ROUTES[0])},
+    {"query", HttpMethod::GET, ECP_ROUTE_OTHER, false, ECP_QUERY_ROUTES,
+     sizeof(ECP_QUERY_ROUTES) / sizeof(ECP_QUERY_ROUTES[0])},
+    {"ecp-session", HttpMethod::GET, ECP_ROUTE_ECP_SESSION, false},
+};
+
+static constexpr uint8_t ECP_ROUTE_ROOT_COUNT = sizeof(ECP_ROUTES) / sizeof(ECP_ROUTES[0]);
+
+// Resolves a request in one pass over the URI, comparing each segment only
+// against the few candidates at its level. For parameter routes *param points
+// at the rest of the path (inside uri). Anything unmatched, including a known
+// path with the wrong method, is ECP_ROUTE_OTHER.
+inline EcpRoute match_ecp_route(HttpMethod method, char *uri, char **param) {
+  *param = uri + strlen(uri);
+  if (*uri != '/')
+    return ECP_ROUTE_OTHER;
+  char *segment = uri + 1;
+  const RouteNode *level = ECP_ROUTES;
+  uint8_t count = ECP_ROUTE_ROOT_COUNT;
+  for (;;) {
+    char *slash = strchr(segment, '/');
+    size_t len = slash != nullptr ? slash - segment : strlen(segment);
+
+    const RouteNode *node = nullptr;
+    for (uint8_t i = 0; i < count; i++) {
+      if (level[i].len == len && memcmp(level[i].segment, segment, len) == 0) {
+        node = &level[i];
+        break;
+      }
+    }
+    if (node == nullptr)
+      return ECP_ROUTE_OTHER;
+
+    if (node->children != nullptr) {
+      if (slash == nullptr)
+        return node->method == method ? node->route : ECP_ROUTE_OTHER;
+      segment = slash + 1;
+      level = node->children;
+      count = node->child_count;
+      continue;
+    }
+    if (node->method != method)
+      return ECP_ROUTE_OTHER;
+    if (node->param) {
+      if (slash == nullptr)
+        return ECP_ROUTE_OTHER;
+      *param = slash + 1;
+      return node->route;
+    }
+    return slash == nullptr ? node->route : ECP_ROUTE_OTHER;
+  }
+}
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,69 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    CONF_ID,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
+)
+
+from . import EmulatedRokuComponent, emulated_roku_ns
+
+DEPENDENCIES = ["emulated_roku"]
+
+CONF_EMULATED_ROKU_ID = "emulated_roku_id"
+CONF_KEYPRESS_LATENCY = "keypress_latency"
+CONF_KEY_DISPATCH_TIME = "key_dispatch_time"
+CONF_HTTP_REQUESTS = "http_requests"
+CONF_SSDP_SEARCHES = "ssdp_searches"
+CONF_SSDP_ANSWERED = "ssdp_answered"
+
+EmulatedRokuSensor = emulated_roku_ns.class_("EmulatedRokuSensor", cg.PollingComponent)
+
+LATENCY_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    icon="mdi:timer-outline",
+    accuracy_decimals=3,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+COUNTER_SCHEMA = sensor.sensor_schema(
+    icon="mdi:counter",
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_TOTAL_INCREASING,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+SENSORS = {
+    CONF_KEYPRESS_LATENCY: LATENCY_SCHEMA,
+    CONF_KEY_DISPATCH_TIME: LATENCY_SCHEMA,
+    CONF_HTTP_REQUESTS: COUNTER_SCHEMA,
+    CONF_SSDP_SEARCHES: COUNTER_SCHEMA,
+    CONF_SSDP_ANSWERED: COUNTER_SCHEMA,
+}
+
+CONFIG_SCHEMA = (
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.declare_id(EmulatedRokuSensor),
+            cv.GenerateID(CONF_EMULATED_ROKU_ID): cv.use_id(EmulatedRokuComponent),
+        }
+    )
+    .extend({cv.Optional(key): schema for key, schema in SENSORS.items()})
+    .extend(cv.polling_component_schema("60s"))
+)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    parent = await cg.get_variable(config[CONF_EMULATED_ROKU_ID])
+    cg.add(var.set_parent(parent))
+
+    for key in SENSORS:
+        if conf := config.get(key):
+            sens = await sensor.new_sensor(conf)
+            cg.add(getattr(var, f"set_{key}_sensor")(sens))
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace emulated_roku {
+
+// Minimal SHA-1, enough for the WebSocket accept key and the ECP-2
+// authentication response. Both hash a few dozen bytes once per connection,
+// so it favours size over speed and works the same on every platform.
+class Sha1 {
+ public:
+  static const size_t DIGEST_SIZE = 20;
+
+  void update(const void *data, size_t len) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < len; i++) {
+      block_[block_len_++] = bytes[i];
+      if (block_len_ == 64) {
+        process_block_();
+        block_len_ = 0;
+      }
+    }
+    total_len_ += len;
+  }
+
+  void finish(uint8_t digest[DIGEST_SIZE]) {
+    uint64_t bits = total_len_ * 8;
+    uint8_t pad = 0x80;
+    update(&pad, 1);
+    pad = 0;
+    while (block_len_ != 56)
+      update(&pad, 1);
+    uint8_t length[8];
+    for (int i = 0; i < 8; i++)
+      length[i] = bits >> (56 - 8 * i);
+    update(length, 8);
+    for (int i = 0; i < 5; i++) {
+      digest[4 * i] = state_[i] >> 24;
+      digest[4 * i + 1] = state_[i] >> 16;
+      digest[4 * i + 2] = state_[i] >> 8;
+      digest[4 * i + 3] = state_[i];
+    }
+  }
+
+ protected:
+  static uint32_t rotl_(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+  void process_block_() {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      w[i] = (uint32_t) block_[4 * i] << 24 | (uint32_t) block_[4 * i + 1] << 16 | (uint32_t) block_[4 * i + 2] << 8 |
+             block_[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++)
+      w[i] = rotl_(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3], e = state_[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t temp = rotl_(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotl_(b, 30);
+      b = a;
+      a = temp;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+  }
+
+  uint32_t state_[5]{0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  uint8_t block_[64];
+  size_t block_len_{0};
+  uint64_t total_len_{0};
+};
+
+// Standard base64 with padding into out, which needs 4 * ceil(len / 3) + 1
+// bytes. Returns the encoded length.
+inline size_t base64_encode_to(const uint8_t *data, size_t len, char *out) {
+  static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t pos = 0;
+  for (size_t i = 0; i < len; i += 3) {
+    uint32_t chunk = (uint32_t) data[i] << 16;
+    if (i + 1 < len)
+      chunk |= (uint32_t) data[i + 1] << 8;
+    if (i + 2 < len)
+      chunk |= data[i + 2];
+    out[pos++] = ALPHABET[(chunk >> 18) & 0x3F];
+    out[pos++] = ALPHABET[(chunk >> 12) & 0x3F];
+    out[pos++] = i + 1 < len ? ALPHABET[(chunk >> 6) & 0x3F] : '=';
+    out[pos++] = i + 2 < len ? ALPHABET[chunk & 0x3F] : '=';
+  }
+  out[pos] = '\0';
+  return pos;
+}
+
+// base64(SHA-1(a + b)), the shape of both the WebSocket accept key and the
+// ECP-2 authentication response. out needs 29 bytes.
+inline void sha1_base64(const char *a, const char *b, char *out) {
+  Sha1 sha;
+  sha.update(a, strlen(a));
+  sha.update(b, strlen(b));
+  uint8_t digest[Sha1::DIGEST_SIZE];
+  sha.finish(digest);
+  base64_encode_to(digest, sizeof(digest), out);
+}
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace emulated_roku {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Used to hand key events from the network task to the main loop.
+// Head and tail only ever grow, so "full" and "empty" need no spare slot.
+template<typename T, size_t N> class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+ public:
+  // Producer side. Returns false (and counts an overflow) if the queue is full.
+  bool push(const T &item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t depth = head - tail_.load(std::memory_order_acquire);
+    if (depth == N) {
+      overflows_.store(overflows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    buffer_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    if (depth + 1 > high_water_.load(std::memory_order_relaxed))
+      high_water_.store(depth + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Consumer side. Returns false if the queue is empty.
+  bool pop(T &item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+      return false;
+    item = buffer_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Safe to call from either side; the result may be stale by the time it's used.
+  // Tail is read first: head only grows, so it can't be behind the tail read
+  // before it, but the consumer may pop in between, so the result is clamped.
+  size_t size() const {
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t depth = head_.load(std::memory_order_acquire) - tail;
+    return depth < N ? depth : N;
+  }
+  static constexpr size_t capacity() { return N; }
+  uint32_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+  size_t high_water() const { return high_water_.load(std::memory_order_relaxed); }
+
+ protected:
+  T buffer_[N];
+  std::atomic<size_t> head_{0};  // Written by the producer only
+  std::atomic<size_t> tail_{0};  // Written by the consumer only
+  std::atomic<uint32_t> overflows_{0};
+  std::atomic<size_t> high_water_{0};
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "net_compat.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace esphome {
+namespace emulated_roku {
+
+static const uint16_t SSDP_PORT = 1900;
+static const uint8_t SSDP_MAX_DATAGRAMS_PER_LOOP = 16;  // Upper bound on datagrams drained per loop
+static const uint32_t SSDP_RECEIVE_BUDGET_US = 2000;    // Stop draining once this much time is spent
+// Replies are spread over the requester's MX window, but never later than this:
+// hubs repeat their searches anyway and discovery should stay snappy.
+static const uint32_t SSDP_MAX_REPLY_DELAY_MS = 500;
+
+struct SsdpStats {
+  uint32_t received{0};   // Datagrams read from the multicast socket
+  uint32_t searches{0};   // M-SEARCHes for roku:ecp or ssdp:all
+  uint32_t filtered{0};   // Ignored: not an M-SEARCH, or searching for another device type
+  uint32_t coalesced{0};  // Duplicate searches folded into a reply that was already pending
+  uint32_t answered{0};   // Replies sent
+};
+
+enum SsdpSearchTarget : uint8_t {
+  SSDP_ST_OTHER = 0,
+  SSDP_ST_ALL,
+  SSDP_ST_ROKU_ECP,
+};
+
+struct SsdpSearch {
+  bool valid;               // M-SEARCH with no conflicting MAN header
+  SsdpSearchTarget target;
+  uint8_t mx;               // Seconds the requester waits for replies, 0 if absent
+};
+
+// Parses an M-SEARCH in a single pass, visiting each header line once and
+// looking only at MAN, ST and MX. The buffer need not be NUL-terminated.
+inline SsdpSearch parse_ssdp_search(const char *data, size_t len) {
+  SsdpSearch search{false, SSDP_ST_OTHER, 0};
+  if (len < 9 || memcmp(data, "M-SEARCH ", 9) != 0)
+    return search;
+  search.valid = true;
+
+  const char *end = data + len;
+  const char *line = static_cast<const char *>(memchr(data, '\n', len));
+  while (line != nullptr && ++line < end) {
+    const char *eol = static_cast<const char *>(memchr(line, '\n', end - line));
+    const char *line_end = eol != nullptr ? eol : end;
+    if (line_end > line && line_end[-1] == '\r')
+      line_end--;
+
+    const char *colon = static_cast<const char *>(memchr(line, ':', line_end - line));
+    if (colon != nullptr) {
+      size_t name_len = colon - line;
+      const char *value = colon + 1;
+      while (value < line_end && *value == ' ')
+        value++;
+      size_t value_len = line_end - value;
+
+      if (name_len == 2 && strncasecmp(line, "ST", 2) == 0) {
+        if (value_len == 8 && strncasecmp(value, "ssdp:all", 8) == 0) {
+          search.target = SSDP_ST_ALL;
+        } else if (value_len >= 8 && strncasecmp(value, "roku:ecp", 8) == 0) {
+          search.target = SSDP_ST_ROKU_ECP;
+        }
+      } else if (name_len == 2 && strncasecmp(line, "MX", 2) == 0) {
+        char digits[4] = {};
+        memcpy(digits, value, value_len < 3 ? value_len : 3);
+        long mx = strtol(digits, nullptr, 10);
+        search.mx = mx < 0 ? 0 : (mx > 120 ? 120 : mx);
+      } else if (name_len == 3 && strncasecmp(line, "MAN", 3) == 0) {
+        // Some hubs omit MAN entirely, so only reject an explicit mismatch
+        if (value_len < 15 || strncasecmp(value, "\"ssdp:discover\"", 15) != 0)
+          search.valid = false;
+      }
+    }
+    line = eol;
+  }
+  return search;
+}
+
+// Timer wheel that holds M-SEARCH replies until their randomised send time.
+// Each slot covers TICK_MS; a pending reply for a requester that searches
+// again is reused instead of scheduling a second one.
+class SsdpReplyScheduler {
+ public:
+  static const uint8_t WHEEL_SLOTS = 16;
+  static const uint32_t TICK_MS = 50;  // WHEEL_SLOTS * TICK_MS must exceed SSDP_MAX_REPLY_DELAY_MS
+  static const uint8_t MAX_PENDING = 8;
+  static_assert(WHEEL_SLOTS * TICK_MS > SSDP_MAX_REPLY_DELAY_MS, "timer wheel too short");
+
+  enum Result : uint8_t { SCHEDULED, COALESCED, FULL };
+
+  SsdpReplyScheduler() {
+    for (auto &head : wheel_)
+      head = NONE;
+  }
+
+  Result schedule(const struct sockaddr_in &to, uint32_t delay_ms, uint32_t now) {
+    uint8_t free_entry = NONE;
+    for (uint8_t i = 0; i < MAX_PENDING; i++) {
+      if (!entries_[i].used) {
+        if (free_entry == NONE)
+          free_entry = i;
+      } else if (entries_[i].to.sin_addr.s_addr == to.sin_addr.s_addr && entries_[i].to.sin_port == to.sin_port) {
+        return COALESCED;
+      }
+    }
+    if (free_entry == NONE)
+      return FULL;
+
+    if (count_ == 0)
+      current_tick_ = now / TICK_MS;
+    uint32_t ticks = (delay_ms + TICK_MS - 1) / TICK_MS;
+    if (ticks >= WHEEL_SLOTS)
+      ticks = WHEEL_SLOTS - 1;
+    uint8_t slot = (current_tick_ + ticks) % WHEEL_SLOTS;
+
+    Entry &entry = entries_[free_entry];
+    entry.to = to;
+    entry.used = true;
+    entry.next = wheel_[slot];
+    wheel_[slot] = free_entry;
+    count_++;
+    return SCHEDULED;
+  }
+
+  // Calls send(const sockaddr_in &) for every reply that is due.
+  template<typename F> void run(uint32_t now, F &&send) {
+    uint32_t tick = now / TICK_MS;
+    while (count_ > 0) {
+      uint8_t &head = wheel_[current_tick_ % WHEEL_SLOTS];
+      while (head != NONE) {
+        Entry &entry = entries_[head];
+        head = entry.next;
+        entry.used = false;
+        count_--;
+        send(entry.to);
+      }
+      if (current_tick_ == tick)
+        break;
+      current_tick_++;
+    }
+  }
+
+  uint8_t pending() const { return count_; }
+
+ protected:
+  static const uint8_t NONE = 0xFF;
+
+  struct Entry {
+    struct sockaddr_in to;
+    uint8_t next{NONE};
+    bool used{false};
+  };
+
+  Entry entries_[MAX_PENDING];
+  uint8_t wheel_[WHEEL_SLOTS];
+  uint8_t count_{0};
+  uint32_t current_tick_{0};
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
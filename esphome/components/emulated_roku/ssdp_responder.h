@@ -0,0 +1,518 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "net_compat.h"
+#include "net_interfaces.h"
+#include "ssdp.h"
+#include <atomic>
+#include <cstring>
+
+namespace esphome {
+namespace emulated_roku {
+
+// Each device slot holds its datagrams for every interface, about 1 KB, so the
+// table is sized by codegen to the devices in the config (see __init__.py)
+#ifdef EMULATED_ROKU_DEVICE_COUNT
+static const uint8_t SSDP_MAX_DEVICES = EMULATED_ROKU_DEVICE_COUNT;
+#else
+static const uint8_t SSDP_MAX_DEVICES = 1;
+#endif
+static const uint8_t SSDP_MAX_NOTIFY_TARGETS = 4;  // Unicast NOTIFY recipients, e.g. a hub that ignores multicast
+static const size_t SSDP_DATAGRAM_SIZE = 256;
+// NOTIFYs go out at once, then 1 s, 2 s, 4 s, ... apart until the steady interval
+static const uint32_t SSDP_NOTIFY_INITIAL_INTERVAL = 1000;
+static const uint32_t SSDP_DEFAULT_NOTIFY_INTERVAL = 60000;
+
+// One SSDP endpoint shared by every emulated Roku on the board.
+//
+// Only one socket can usefully listen on port 1900, so instead of each device
+// binding its own, all of them register here. A search is received, parsed and
+// scheduled once no matter how many devices there are; only the replies (one
+// short datagram per device) grow with N. NOTIFYs for all devices go out
+// back to back from a single timer.
+//
+// Replies and NOTIFYs are formatted once per device and interface and only
+// rebuilt when an address changes, so answering a search is a sendto() per
+// device.
+//
+// On a board with both Ethernet and WiFi the one socket joins the multicast
+// group on each interface. A search is answered with the Location of the
+// interface whose subnet the requester is on (lwIP can't report the arrival
+// interface of a datagram), and NOTIFYs go out on every interface in one pass.
+//
+// The first device to start claims ownership and calls loop() from its own
+// loop or network task; the others only register.
+class SsdpResponder {
+ public:
+  struct Datagram {
+    uint16_t len;
+    char data[SSDP_DATAGRAM_SIZE];
+  };
+  struct Device {
+    const char *usn;
+    uint16_t port;
+    // By interface, each naming its own address in Location
+    Datagram response[MAX_NET_INTERFACES];
+    Datagram notify[MAX_NET_INTERFACES];
+  };
+
+  // Returns false if the device table is full.
+  bool add_device(const char *usn, uint16_t port) {
+    uint8_t count = device_count_.load(std::memory_order_relaxed);
+    if (count == SSDP_MAX_DEVICES) {
+      ESP_LOGE("emulated_roku", "Too many emulated Roku devices, at most %d can share SSDP", SSDP_MAX_DEVICES);
+      return false;
+    }
+    Device &device = devices_[count];
+    device.usn = usn;
+    device.port = port;
+    build_datagrams(device);
+    // Publish the entry only once it is complete; the owner may be reading from its task
+    device_count_.store(count + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns true if the caller is (now) the owner that drives loop().
+  bool claim(const void *owner) {
+    if (owner_ == nullptr) {
+      owner_ = owner;
+    }
+    return owner_ == owner;
+  }
+
+  // Addresses are in network byte order.
+  void add_notify_target(uint32_t addr) {
+    uint8_t count = target_count_.load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < count; i++) {
+      if (notify_targets_[i] == addr) {
+        return;
+      }
+    }
+    if (count == SSDP_MAX_NOTIFY_TARGETS) {
+      ESP_LOGW("emulated_roku", "Too many SSDP notify targets, at most %d", SSDP_MAX_NOTIFY_TARGETS);
+      return;
+    }
+    notify_targets_[count] = addr;
+    target_count_.store(count + 1, std::memory_order_release);
+  }
+
+  // The shortest interval asked for by any device wins.
+  void set_notify_interval(uint32_t interval) {
+    if (notify_interval_ == 0 || interval < notify_interval_) {
+      notify_interval_ = interval;
+    }
+  }
+
+  void begin(const NetInterfaces &interfaces) {
+    set_interfaces(interfaces);
+    // Use raw BSD sockets for multicast - more reliable than WiFiUDP
+    create_multicast_socket();
+    restart_announcements();
+  }
+
+  // Rebuilds every device's datagrams if an address changed. Returns true if it did.
+  bool set_interfaces(const NetInterfaces &interfaces) {
+    if (interfaces.same_addresses(interfaces_)) {
+      return false;
+    }
+    interfaces_ = interfaces;
+    for (uint8_t i = 0; i < interfaces_.count; i++) {
+      // Subnet broadcast as a fallback for networks that block multicast; not
+      // meaningful without a netmask or on a point-to-point link
+      uint32_t addr = interfaces_.list[i].addr;
+      uint32_t netmask = interfaces_.list[i].netmask;
+      broadcast_[i] = netmask != 0 && netmask != 0xFFFFFFFF ? (addr & netmask) | ~netmask : 0;
+    }
+
+    uint8_t count = device_count();
+    for (uint8_t i = 0; i < count; i++) {
+      build_datagrams(devices_[i]);
+    }
+    return true;
+  }
+
+  // Called by the owner after a reconnect or an address change. If an address
+  // went away, says ssdp:byebye for the old Locations first; then re-joins the
+  // multicast group on the current interfaces and announces again right away.
+  void handle_network_change(const NetInterfaces &interfaces) {
+    bool moved = false;
+    for (uint8_t i = 0; i < interfaces_.count; i++) {
+      moved |= !interfaces.contains(interfaces_.list[i].addr);
+    }
+    if (moved && mcast_sock_ >= 0) {
+      send_byebye();
+    }
+    set_interfaces(interfaces);
+    create_multicast_socket();
+    restart_announcements();
+  }
+
+  // Starts the quick startup sequence of NOTIFYs over again.
+  void restart_announcements() {
+    notify_backoff_ = SSDP_NOTIFY_INITIAL_INTERVAL;
+    next_notify_ = millis();
+  }
+
+  int fd() const { return mcast_sock_; }
+  uint32_t notify_interval() const { return notify_interval_ != 0 ? notify_interval_ : SSDP_DEFAULT_NOTIFY_INTERVAL; }
+  const SsdpStats &get_stats() const { return stats_; }
+  uint8_t device_count() const { return device_count_.load(std::memory_order_acquire); }
+
+  // With readable false (select() saw nothing on the socket) only the timers run.
+  void loop(bool readable) {
+    if (!started_ || mcast_sock_ < 0) {
+      // Try to recover SSDP if it failed to start
+      unsigned long now = millis();
+      if (now - last_retry_ > 10000) {  // Retry every 10 seconds
+        ESP_LOGW("emulated_roku", "SSDP not started, attempting to initialize");
+        create_multicast_socket();
+        last_retry_ = now;
+      }
+      return;
+    }
+
+    // Refresh IGMP membership periodically
+    refresh_multicast_membership();
+
+    // Drain everything queued on the socket so our replies don't wait behind
+    // other devices' chatter, bounded by count and time to protect the loop
+    char buffer[512];
+    uint32_t start = micros();
+    for (uint8_t i = 0; readable && i < SSDP_MAX_DATAGRAMS_PER_LOOP; i++) {
+      struct sockaddr_in remote_addr;
+      socklen_t addr_len = sizeof(remote_addr);
+      int len = lwip_recvfrom(mcast_sock_, buffer, sizeof(buffer) - 1, 0,
+                              (struct sockaddr*)&remote_addr, &addr_len);
+      if (len <= 0) {
+        break;
+      }
+      stats_.received++;
+
+      // Reject NOTIFYs and responses from other devices on the request line alone
+      if (len < 9 || memcmp(buffer, "M-SEARCH ", 9) != 0) {
+        stats_.filtered++;
+      } else {
+        handle_search(buffer, len, remote_addr);
+      }
+
+      if (micros() - start > SSDP_RECEIVE_BUDGET_US) {
+        break;
+      }
+    }
+
+    replies_.run(millis(), [this](const struct sockaddr_in &remote_addr) { send_responses(remote_addr); });
+
+    // Periodic SSDP notify, backing off from quick startup announcements
+    uint32_t now = millis();
+    if ((int32_t) (now - next_notify_) >= 0) {
+      send_notify();
+      next_notify_ = now + notify_backoff_;
+      notify_backoff_ = notify_backoff_ * 2 < notify_interval() ? notify_backoff_ * 2 : notify_interval();
+    }
+  }
+
+ protected:
+  static const unsigned long IGMP_REFRESH_INTERVAL = 60000; // Refresh IGMP membership every 60 seconds
+
+  void create_multicast_socket() {
+    // Close existing socket if any
+    if (mcast_sock_ >= 0) {
+      lwip_close(mcast_sock_);
+      mcast_sock_ = -1;
+    }
+
+    // Create UDP socket
+    mcast_sock_ = lwip_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (mcast_sock_ < 0) {
+      ESP_LOGE("emulated_roku", "Failed to create multicast socket");
+      return;
+    }
+
+    // Allow address reuse
+    int reuse = 1;
+    lwip_setsockopt(mcast_sock_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // NOTIFYs go out through this socket too, including the subnet broadcast
+    int broadcast = 1;
+    lwip_setsockopt(mcast_sock_, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+
+    // Bind to SSDP port on all interfaces (important: bind to INADDR_ANY, not local IP)
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SSDP_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);  // Bind to all interfaces
+
+    if (lwip_bind(mcast_sock_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+      ESP_LOGE("emulated_roku", "Failed to bind multicast socket: %d", errno);
+      lwip_close(mcast_sock_);
+      mcast_sock_ = -1;
+      return;
+    }
+
+    // Join the multicast group on every interface - this is the key part
+    uint8_t joined = 0;
+    for (uint8_t i = 0; i < interfaces_.count; i++) {
+      if (join_multicast_group(interfaces_.list[i].addr)) {
+        joined++;
+      } else {
+        ESP_LOGW("emulated_roku", "Failed to join multicast group on %s: %d", interfaces_.list[i].ip, errno);
+      }
+    }
+    if (joined == 0) {
+      ESP_LOGE("emulated_roku", "Failed to join multicast group on any interface");
+      lwip_close(mcast_sock_);
+      mcast_sock_ = -1;
+      return;
+    }
+
+    // Set socket to non-blocking
+    int flags = lwip_fcntl(mcast_sock_, F_GETFL, 0);
+    lwip_fcntl(mcast_sock_, F_SETFL, flags | O_NONBLOCK);
+
+    char joined_on[64];
+    interfaces_.describe(joined_on, sizeof(joined_on));
+    ESP_LOGI("emulated_roku", "SSDP multicast socket created and joined group on %s", joined_on);
+    started_ = true;
+    last_igmp_refresh_ = millis();
+  }
+
+  bool join_multicast_group(uint32_t interface_addr) {
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr.s_addr = multicast_addr_;
+    mreq.imr_interface.s_addr = interface_addr;
+    return lwip_setsockopt(mcast_sock_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == 0;
+  }
+
+  void refresh_multicast_membership() {
+    // Periodically refresh IGMP membership to ensure we stay in the group
+    unsigned long now = millis();
+    if (now - last_igmp_refresh_ > IGMP_REFRESH_INTERVAL) {
+      if (mcast_sock_ >= 0) {
+        // Leave and rejoin on every interface to refresh
+        bool failed = false;
+        for (uint8_t i = 0; i < interfaces_.count; i++) {
+          struct ip_mreq mreq;
+          mreq.imr_multiaddr.s_addr = multicast_addr_;
+          mreq.imr_interface.s_addr = interfaces_.list[i].addr;
+          lwip_setsockopt(mcast_sock_, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
+          failed |= !join_multicast_group(interfaces_.list[i].addr);
+        }
+        if (failed) {
+          ESP_LOGW("emulated_roku", "IGMP refresh failed, recreating socket");
+          create_multicast_socket();
+        } else {
+          ESP_LOGD("emulated_roku", "Refreshed IGMP membership");
+        }
+      }
+      last_igmp_refresh_ = now;
+    }
+  }
+
+  // Multicast and broadcast NOTIFYs for one interface leave through it
+  void set_multicast_interface(uint8_t index) {
+    struct in_addr addr;
+    addr.s_addr = interfaces_.list[index].addr;
+    lwip_setsockopt(mcast_sock_, IPPROTO_IP, IP_MULTICAST_IF, &addr, sizeof(addr));
+  }
+
+  void handle_search(const char *buffer, int len, const struct sockaddr_in &remote_addr) {
+    SsdpSearch search = parse_ssdp_search(buffer, len);
+    if (!search.valid || search.target == SSDP_ST_OTHER) {
+      stats_.filtered++;
+      return;
+    }
+    stats_.searches++;
+
+    // Spread replies over the MX window so simultaneous searches from several
+    // controllers don't all get answered in the same burst
+    uint32_t window = search.mx * 1000;
+    if (window > SSDP_MAX_REPLY_DELAY_MS) {
+      window = SSDP_MAX_REPLY_DELAY_MS;
+    }
+    uint32_t delay = window > 0 ? random_uint32() % window : 0;
+
+    char remote_ip[16];
+    inet_ntoa_r(remote_addr.sin_addr, remote_ip, sizeof(remote_ip));
+    uint16_t remote_port = ntohs(remote_addr.sin_port);
+
+    switch (replies_.schedule(remote_addr, delay, millis())) {
+      case SsdpReplyScheduler::SCHEDULED:
+        ESP_LOGD("emulated_roku", "M-SEARCH from %s:%d (MX %d), replying in %u ms",
+                 remote_ip, remote_port, search.mx, (unsigned) delay);
+        break;
+      case SsdpReplyScheduler::COALESCED:
+        ESP_LOGD("emulated_roku", "M-SEARCH from %s:%d already has a reply pending", remote_ip, remote_port);
+        stats_.coalesced++;
+        break;
+      case SsdpReplyScheduler::FULL:
+        // Never drop a search, answer straight away if the wheel is full
+        send_responses(remote_addr);
+        break;
+    }
+  }
+
+  // One reply per device, each naming its own ECP port and USN, and the
+  // address of the interface facing the requester
+  void send_responses(const struct sockaddr_in &remote_addr) {
+    uint8_t count = device_count();
+    uint8_t iface = interfaces_.route(remote_addr.sin_addr.s_addr);
+    for (uint8_t i = 0; i < count; i++) {
+      const Datagram &response = devices_[i].response[iface];
+      // Send response back to requester using the same socket
+      lwip_sendto(mcast_sock_, response.data, response.len, 0,
+                  (struct sockaddr*)&remote_addr, sizeof(remote_addr));
+      stats_.answered++;
+    }
+
+    char remote_ip[16];
+    inet_ntoa_r(remote_addr.sin_addr, remote_ip, sizeof(remote_ip));
+    ESP_LOGV("emulated_roku", "Sent SSDP response for %d device(s) to %s:%d via %s",
+             count, remote_ip, ntohs(remote_addr.sin_port), interfaces_.list[iface].ip);
+  }
+
+  void build_datagrams(Device &device) {
+    for (uint8_t i = 0; i < interfaces_.count; i++) {
+      build_datagrams(device, interfaces_.list[i].ip, device.response[i], device.notify[i]);
+    }
+  }
+
+  // Formats into a local buffer and copies from there: ip and the USN live in
+  // the same objects as the datagrams, so formatting in place could overlap.
+  static void build_datagrams(const Device &device, const char *ip, Datagram &response, Datagram &notify) {
+    char text[SSDP_DATAGRAM_SIZE];
+    // Match exact format from Python emulated_roku library that works with Harmony
+    int len = snprintf(text, sizeof(text),
+      "HTTP/1.1 200 OK\r\n"
+      "Cache-Control: max-age = 300\r\n"
+      "ST: roku:ecp\r\n"
+      "SERVER: Roku/12.0.0 UPnP/1.0 Roku/12.0.0\r\n"
+      "Ext:\r\n"
+      "Location: http://%s:%d/\r\n"
+      "USN: uuid:roku:ecp:%s\r\n"
+      "\r\n",
+      ip,
+      device.port,
+      device.usn
+    );
+    store_datagram(response, text, len);
+
+    len = snprintf(text, sizeof(text),
+      "NOTIFY * HTTP/1.1\r\n"
+      "HOST: 239.255.255.250:1900\r\n"
+      "Cache-Control: max-age = 300\r\n"
+      "NT: roku:ecp\r\n"
+      "NTS: ssdp:alive\r\n"
+      "SERVER: Roku/12.0.0 UPnP/1.0 Roku/12.0.0\r\n"
+      "Location: http://%s:%d/\r\n"
+      "USN: uuid:roku:ecp:%s\r\n"
+      "\r\n",
+      ip,
+      device.port,
+      device.usn
+    );
+    store_datagram(notify, text, len);
+  }
+
+  static void store_datagram(Datagram &datagram, const char *text, int len) {
+    datagram.len = len < (int) sizeof(datagram.data) ? len : sizeof(datagram.data) - 1;
+    memcpy(datagram.data, text, datagram.len);
+    datagram.data[datagram.len] = '\0';
+  }
+
+  void send_datagram(const char *datagram, size_t len, uint32_t addr) {
+    struct sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_port = htons(SSDP_PORT);
+    to.sin_addr.s_addr = addr;
+    lwip_sendto(mcast_sock_, datagram, len, 0, (struct sockaddr*)&to, sizeof(to));
+  }
+
+  // Sent on the old interfaces, before the datagrams are rebuilt
+  void send_byebye() {
+    uint8_t count = device_count();
+    uint8_t targets = target_count_.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < count; i++) {
+      char byebye[SSDP_DATAGRAM_SIZE];
+      int len = snprintf(byebye, sizeof(byebye),
+        "NOTIFY * HTTP/1.1\r\n"
+        "HOST: 239.255.255.250:1900\r\n"
+        "NT: roku:ecp\r\n"
+        "NTS: ssdp:byebye\r\n"
+        "USN: uuid:roku:ecp:%s\r\n"
+        "\r\n",
+        devices_[i].usn
+      );
+      for (uint8_t n = 0; n < interfaces_.count; n++) {
+        set_multicast_interface(n);
+        send_datagram(byebye, len, multicast_addr_);
+        if (broadcast_[n] != 0) {
+          send_datagram(byebye, len, broadcast_[n]);
+        }
+      }
+      for (uint8_t t = 0; t < targets; t++) {
+        send_datagram(byebye, len, notify_targets_[t]);
+      }
+    }
+    ESP_LOGD("emulated_roku", "Sent SSDP byebye for %d device(s) on %d interface(s)", count, interfaces_.count);
+  }
+
+  // All devices on all interfaces are announced in the same cycle
+  void send_notify() {
+    uint8_t count = device_count();
+    uint8_t targets = target_count_.load(std::memory_order_acquire);
+    uint8_t destinations = targets;
+    for (uint8_t n = 0; n < interfaces_.count; n++) {
+      set_multicast_interface(n);
+      for (uint8_t i = 0; i < count; i++) {
+        const Datagram &notify = devices_[i].notify[n];
+        // Send to standard SSDP multicast
+        send_datagram(notify.data, notify.len, multicast_addr_);
+        if (broadcast_[n] != 0) {
+          send_datagram(notify.data, notify.len, broadcast_[n]);
+        }
+      }
+      destinations += 1 + (broadcast_[n] != 0);
+    }
+    // Hubs configured by address, for networks where neither of the above
+    // gets through; each is sent the Location on its side
+    for (uint8_t t = 0; t < targets; t++) {
+      uint8_t n = interfaces_.route(notify_targets_[t]);
+      for (uint8_t i = 0; i < count; i++) {
+        const Datagram &notify = devices_[i].notify[n];
+        send_datagram(notify.data, notify.len, notify_targets_[t]);
+      }
+    }
+
+    ESP_LOGD("emulated_roku", "Sent SSDP notify for %d device(s) to %d destination(s), next in %u ms", count,
+             destinations, (unsigned) notify_backoff_);
+  }
+
+  Device devices_[SSDP_MAX_DEVICES];
+  std::atomic<uint8_t> device_count_{0};
+  const void *owner_{nullptr};
+  uint32_t notify_targets_[SSDP_MAX_NOTIFY_TARGETS]{};
+  std::atomic<uint8_t> target_count_{0};
+  NetInterfaces interfaces_;
+  uint32_t broadcast_[MAX_NET_INTERFACES]{};  // By interface, 0 when there is no usable subnet broadcast
+  uint32_t multicast_addr_{inet_addr("239.255.255.250")};
+  int mcast_sock_{-1};  // Raw socket for multicast SSDP
+  SsdpStats stats_;
+  SsdpReplyScheduler replies_;
+  uint32_t notify_interval_{0};  // 0 until a device sets it
+  uint32_t notify_backoff_{SSDP_NOTIFY_INITIAL_INTERVAL};
+  uint32_t next_notify_{0};
+  unsigned long last_igmp_refresh_{0};
+  unsigned long last_retry_{0};
+  bool started_{false};
+};
+
+// Created by the first emulated Roku that starts, shared by the rest
+inline SsdpResponder *global_ssdp_responder = nullptr;
+
+}  // namespace emulated_roku
+}  // namespace esphome
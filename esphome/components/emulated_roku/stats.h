@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace emulated_roku {
+
+// ECP endpoints that are counted separately. Everything unmatched, including
+// malformed requests, lands in ECP_ROUTE_OTHER.
+enum EcpRoute : uint8_t {
+  ECP_ROUTE_OTHER = 0,
+  ECP_ROUTE_ROOT,
+  ECP_ROUTE_KEYPRESS,
+  ECP_ROUTE_KEYDOWN,
+  ECP_ROUTE_KEYUP,
+  ECP_ROUTE_LAUNCH,
+  ECP_ROUTE_APPS,
+  ECP_ROUTE_ACTIVE_APP,
+  ECP_ROUTE_DEVICE_INFO,
+  ECP_ROUTE_ICON,
+  ECP_ROUTE_INPUT,
+  ECP_ROUTE_SEARCH,
+  ECP_ROUTE_STATS,
+  ECP_ROUTE_ECP_SESSION,  // The WebSocket upgrade and every ECP-2 message after it
+  ECP_ROUTE_TRACE,
+  ECP_ROUTE_COUNT,
+};
+
+static constexpr const char *ECP_ROUTE_NAMES[ECP_ROUTE_COUNT] = {
+    "other",
+    "root",
+    "keypress",
+    "keydown",
+    "keyup",
+    "launch",
+    "apps",
+    "active-app",
+    "device-info",
+    "icon",
+    "input",
+    "search",
+    "emulated-stats",
+    "ecp-session",
+    "trace",
+};
+
+inline const char *ecp_route_name(uint8_t route) {
+  return route < ECP_ROUTE_COUNT ? ECP_ROUTE_NAMES[route] : ECP_ROUTE_NAMES[ECP_ROUTE_OTHER];
+}
+
+// Latency histogram with power-of-two buckets: bucket 0 holds 0 us, bucket i
+// holds [2^(i-1), 2^i) us and the last bucket everything slower. 96 bytes,
+// recording is a count-leading-zeros and three adds.
+class LatencyHistogram {
+ public:
+  static const uint8_t BUCKETS = 20;  // Last bucket starts at 2^18 us, about 262 ms
+
+  void record(uint32_t us) {
+    uint8_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= BUCKETS)
+      bucket = BUCKETS - 1;
+    buckets_[bucket]++;
+    count_++;
+    sum_us_ += us;
+    if (us > max_us_)
+      max_us_ = us;
+  }
+
+  uint32_t count() const { return count_; }
+  uint32_t max_us() const { return max_us_; }
+  uint32_t mean_us() const { return count_ != 0 ? sum_us_ / count_ : 0; }
+  uint32_t bucket(uint8_t i) const { return buckets_[i]; }
+
+  // Upper bound of the bucket holding the given percentile (never more than
+  // the maximum seen), 0 when empty.
+  uint32_t percentile_us(uint8_t pct) const {
+    if (count_ == 0)
+      return 0;
+    uint32_t rank = (uint64_t) count_ * pct / 100;
+    uint32_t seen = 0;
+    uint8_t i = 0;
+    for (; i < BUCKETS - 1; i++) {
+      seen += buckets_[i];
+      if (seen > rank)
+        break;
+    }
+    uint32_t upper = bucket_upper_us(i);
+    return upper < max_us_ ? upper : max_us_;
+  }
+
+  // What was recorded after `earlier`, a copy of this histogram taken before.
+  // The maximum can't be split, so it stays the all-time value.
+  LatencyHistogram since(const LatencyHistogram &earlier) const {
+    LatencyHistogram delta = *this;
+    for (uint8_t i = 0; i < BUCKETS; i++)
+      delta.buckets_[i] -= earlier.buckets_[i];
+    delta.count_ -= earlier.count_;
+    delta.sum_us_ -= earlier.sum_us_;
+    return delta;
+  }
+
+  static uint32_t bucket_upper_us(uint8_t i) { return i == 0 ? 1 : 1u << i; }
+
+ protected:
+  uint32_t buckets_[BUCKETS]{};
+  uint32_t count_{0};
+  uint32_t max_us_{0};
+  uint64_t sum_us_{0};
+};
+
+struct RouteStats {
+  uint32_t requests{0};
+  LatencyHistogram latency;  // From accept (or first byte on a kept-alive connection) to response sent
+};
+
+// Fixed-size instrumentation, written from whichever task runs the servers.
+// Readers on another task may see a counter one update behind, never a torn one.
+struct EcpStats {
+  RouteStats routes[ECP_ROUTE_COUNT];
+  LatencyHistogram key_dispatch;  // Time spent in on_key_event and on_key_press triggers
+
+  void record_response(uint8_t route, uint32_t elapsed_us) {
+    if (route >= ECP_ROUTE_COUNT)
+      route = ECP_ROUTE_OTHER;
+    RouteStats &stats = routes[route];
+    stats.requests++;
+    stats.latency.record(elapsed_us);
+  }
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+#ifdef USE_SENSOR
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+#include "emulated_roku.h"
+#include <cmath>
+
+namespace esphome {
+namespace emulated_roku {
+
+// Publishes a few of the ECP counters as sensors, so latency can be watched
+// without verbose logging. Latencies are the 90th percentile of the requests
+// seen since the previous update; counters are running totals.
+class EmulatedRokuSensor : public PollingComponent {
+ public:
+  void set_parent(EmulatedRokuComponent *parent) { parent_ = parent; }
+  void set_keypress_latency_sensor(sensor::Sensor *sensor) { keypress_latency_sensor_ = sensor; }
+  void set_key_dispatch_time_sensor(sensor::Sensor *sensor) { key_dispatch_time_sensor_ = sensor; }
+  void set_http_requests_sensor(sensor::Sensor *sensor) { http_requests_sensor_ = sensor; }
+  void set_ssdp_searches_sensor(sensor::Sensor *sensor) { ssdp_searches_sensor_ = sensor; }
+  void set_ssdp_answered_sensor(sensor::Sensor *sensor) { ssdp_answered_sensor_ = sensor; }
+
+  void update() override {
+    const EcpStats &stats = parent_->get_ecp_stats();
+    if (keypress_latency_sensor_ != nullptr) {
+      LatencyHistogram latency = stats.routes[ECP_ROUTE_KEYPRESS].latency;
+      publish_p90(keypress_latency_sensor_, latency.since(last_keypress_));
+      last_keypress_ = latency;
+    }
+    if (key_dispatch_time_sensor_ != nullptr) {
+      LatencyHistogram dispatch = stats.key_dispatch;
+      publish_p90(key_dispatch_time_sensor_, dispatch.since(last_dispatch_));
+      last_dispatch_ = dispatch;
+    }
+    const HttpStats *http = parent_->get_http_stats();
+    if (http_requests_sensor_ != nullptr && http != nullptr) {
+      http_requests_sensor_->publish_state(http->requests);
+    }
+    if (ssdp_searches_sensor_ != nullptr) {
+      ssdp_searches_sensor_->publish_state(parent_->get_ssdp_stats().searches);
+    }
+    if (ssdp_answered_sensor_ != nullptr) {
+      ssdp_answered_sensor_->publish_state(parent_->get_ssdp_stats().answered);
+    }
+  }
+
+  float get_setup_priority() const override { return setup_priority::DATA; }
+
+ protected:
+  static void publish_p90(sensor::Sensor *sensor, const LatencyHistogram &interval) {
+    // Nothing recorded since the last update: unknown rather than a stale value
+    sensor->publish_state(interval.count() != 0 ? interval.percentile_us(90) / 1000.0f : NAN);
+  }
+
+  EmulatedRokuComponent *parent_{nullptr};
+  sensor::Sensor *keypress_latency_sensor_{nullptr};
+  sensor::Sensor *key_dispatch_time_sensor_{nullptr};
+  sensor::Sensor *http_requests_sensor_{nullptr};
+  sensor::Sensor *ssdp_searches_sensor_{nullptr};
+  sensor::Sensor *ssdp_answered_sensor_{nullptr};
+  // Snapshots from the previous update, for per-interval percentiles
+  LatencyHistogram last_keypress_;
+  LatencyHistogram last_dispatch_;
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
+
+#endif  // USE_SENSOR
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "esphome/core/log.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+
+namespace esphome {
+namespace emulated_roku {
+
+// A response assembled from a printf-style template and a few short field
+// values. The template's static text stays where it is (flash on the ESP32)
+// and is sent from there; only the fields are copied, into a small arena.
+// Length and ETag are computed once, when the response is built.
+//
+// Instances are shared by the connections sending them, so rebuilding one
+// (e.g. after a rename) never invalidates bytes still in flight.
+class TemplateResponse {
+ public:
+  static const uint8_t MAX_SEGMENTS = 32;
+  static const size_t FIELDS_SIZE = 192;
+
+  // fmt may only contain %s conversions, one per field. A field passed more
+  // than once in a row by the same pointer is stored once.
+  TemplateResponse(const char *content_type, const char *fmt, std::initializer_list<const char *> fields) {
+    const char *const *field = fields.begin();
+    const char *last_field = nullptr;
+    const char *stored = nullptr;
+    size_t stored_len = 0;
+    const char *text = fmt;
+    for (;;) {
+      const char *conversion = strstr(text, "%s");
+      if (conversion == nullptr || field == fields.end()) {
+        add_segment_(text, strlen(text));
+        break;
+      }
+      add_segment_(text, conversion - text);
+      if (*field != last_field) {
+        stored = store_field_(*field, &stored_len);
+        last_field = *field;
+      }
+      add_segment_(stored, stored_len);
+      field++;
+      text = conversion + 2;
+    }
+
+    // FNV-1 over the body, for the ETag
+    uint32_t hash = 2166136261UL;
+    for (uint8_t i = 0; i < segment_count_; i++) {
+      for (size_t j = 0; j < segments_[i].len; j++) {
+        hash *= 16777619UL;
+        hash ^= (uint8_t) segments_[i].data[j];
+      }
+    }
+    snprintf(etag_, sizeof(etag_), "\"%08x\"", (unsigned) hash);
+    head_len_ = snprintf(head_, sizeof(head_),
+                         "HTTP/1.1 200 OK\r\n"
+                         "Content-Type: %s\r\n"
+                         "Content-Length: %u\r\n"
+                         "ETag: %s\r\n",
+                         content_type, (unsigned) size_, etag_);
+    not_modified_len_ = snprintf(not_modified_, sizeof(not_modified_), "HTTP/1.1 304 Not Modified\r\nETag: %s\r\n",
+                                 etag_);
+  }
+
+  size_t size() const { return size_; }
+  const char *etag() const { return etag_; }
+  // Status line and headers, up to the Connection header
+  const char *head() const { return head_; }
+  size_t head_len() const { return head_len_; }
+  const char *not_modified() const { return not_modified_; }
+  size_t not_modified_len() const { return not_modified_len_; }
+
+  // Copies up to len bytes of the body starting at offset. Returns the count copied.
+  size_t read(size_t offset, char *out, size_t len) const {
+    size_t copied = 0;
+    for (uint8_t i = 0; i < segment_count_ && copied < len; i++) {
+      const Segment &segment = segments_[i];
+      if (offset >= segment.len) {
+        offset -= segment.len;
+        continue;
+      }
+      size_t n = segment.len - offset;
+      if (n > len - copied)
+        n = len - copied;
+      memcpy(out + copied, segment.data + offset, n);
+      copied += n;
+      offset = 0;
+    }
+    return copied;
+  }
+
+ protected:
+  struct Segment {
+    const char *data;
+    uint16_t len;
+  };
+
+  void add_segment_(const char *data, size_t len) {
+    if (len == 0)
+      return;
+    if (segment_count_ == MAX_SEGMENTS) {
+      ESP_LOGE("emulated_roku", "Response template has too many fields");
+      return;
+    }
+    segments_[segment_count_++] = Segment{data, (uint16_t) len};
+    size_ += len;
+  }
+
+  const char *store_field_(const char *value, size_t *len) {
+    size_t n = strlen(value);
+    if (n > FIELDS_SIZE - fields_len_) {
+      ESP_LOGE("emulated_roku", "Response field truncated: %s", value);
+      n = FIELDS_SIZE - fields_len_;
+    }
+    char *stored = fields_ + fields_len_;
+    memcpy(stored, value, n);
+    fields_len_ += n;
+    *len = n;
+    return stored;
+  }
+
+  Segment segments_[MAX_SEGMENTS];
+  uint8_t segment_count_{0};
+  size_t size_{0};
+  char fields_[FIELDS_SIZE];
+  size_t fields_len_{0};
+  char etag_[12];
+  char head_[160];
+  size_t head_len_{0};
+  char not_modified_[64];
+  size_t not_modified_len_{0};
+};
+using TemplateResponsePtr = std::shared_ptr<const TemplateResponse>;
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace emulated_roku {
+
+struct TextInputStats {
+  uint32_t characters{0};  // Lit_ characters taken in
+  uint32_t texts{0};       // Text events fired for them
+};
+
+// Collects the one-request-per-character Lit_ keypresses a phone app or hub
+// sends while typing into one string, delivered once typing pauses for the
+// debounce window. Backspace edits the pending text. Everything happens in a
+// fixed buffer; like KeyRepeater, the caller supplies the time.
+class TextAssembler {
+ public:
+  static const size_t MAX_TEXT = 64;
+
+  void set_debounce(uint32_t debounce) { debounce_ = debounce; }
+  uint32_t get_debounce() const { return debounce_; }
+
+  // Appends one UTF-8 character. A full buffer is delivered through
+  // on_text(text) first, so nothing typed is lost.
+  template<typename TextFn> void append(const char *character, uint32_t now, TextFn on_text) {
+    size_t len = strlen(character);
+    if (len_ + len > MAX_TEXT)
+      flush(on_text);
+    memcpy(text_ + len_, character, len);
+    len_ += len;
+    text_[len_] = '\0';
+    last_input_ = now;
+    stats_.characters++;
+  }
+
+  // Removes the last character still pending. Returns false if nothing is
+  // pending, so the caller can pass the Backspace key on instead.
+  bool backspace(uint32_t now) {
+    if (len_ == 0)
+      return false;
+    // Step back over UTF-8 continuation bytes to the start of the character
+    do {
+      len_--;
+    } while (len_ > 0 && (text_[len_] & 0xC0) == 0x80);
+    text_[len_] = '\0';
+    last_input_ = now;
+    return true;
+  }
+
+  template<typename TextFn> void flush(TextFn on_text) {
+    if (len_ == 0)
+      return;
+    stats_.texts++;
+    on_text(static_cast<const char *>(text_));
+    len_ = 0;
+    text_[0] = '\0';
+  }
+
+  // Delivers the pending text once no character has arrived for the window.
+  template<typename TextFn> void loop(uint32_t now, TextFn on_text) {
+    if (len_ != 0 && now - last_input_ >= debounce_)
+      flush(on_text);
+  }
+
+  bool pending() const { return len_ != 0; }
+  const TextInputStats &get_stats() const { return stats_; }
+
+ protected:
+  char text_[MAX_TEXT + 1]{};
+  size_t len_{0};
+  uint32_t last_input_{0};
+  uint32_t debounce_{1000};
+  TextInputStats stats_;
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "http_server.h"
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace emulated_roku {
+
+// Points a key event passes on its way from the socket to the triggers. Each
+// is recorded as microseconds since the request began (accept, or the first
+// byte on a kept-alive connection or WebSocket).
+enum TraceStage : uint8_t {
+  TRACE_PARSED = 0,      // Request received and split, handler entered
+  TRACE_ROUTED,          // Route matched
+  TRACE_DECODED,         // Key looked up and its name decoded
+  TRACE_TRIGGERS_START,  // on_key_event/on_key_press about to run, on the main loop
+  TRACE_TRIGGERS_END,
+  TRACE_SENT,  // Last byte of the response handed to the socket
+  TRACE_STAGE_COUNT,
+};
+
+static const uint32_t TRACE_NOT_REACHED = 0xFFFFFFFF;
+
+enum TraceFlag : uint8_t {
+  TRACE_FLAG_ECP2 = 1 << 0,    // Came over an ECP-2 WebSocket
+  TRACE_FLAG_QUEUED = 1 << 1,  // Handed from the network task to the main loop
+};
+
+// One key event. Dumped as is (little-endian on every supported platform),
+// see tools/roku_trace.py.
+struct TraceRecord {
+  uint32_t start_us;  // micros() when the request began
+  uint32_t stage_us[TRACE_STAGE_COUNT];  // Since start_us, TRACE_NOT_REACHED if skipped
+  uint32_t seq;  // Ever increasing, 0 for an unused slot
+  uint8_t route;
+  uint8_t key;
+  uint8_t type;
+  uint8_t flags;
+};
+static_assert(sizeof(TraceRecord) == 36, "the dump format depends on the record layout");
+
+// /query/trace body: this header, then `count` records, oldest first
+struct TraceHeader {
+  char magic[4];  // "RKTR"
+  uint8_t version;
+  uint8_t stages;
+  uint16_t record_size;
+  uint16_t capacity;
+  uint16_t count;
+  uint32_t now_us;  // micros() when the dump started
+};
+static_assert(sizeof(TraceHeader) == 16, "the dump format depends on the header layout");
+
+// Fixed-size ring of per-stage timestamps for key events, to find where the
+// time between a remote's request and the triggers goes. Nothing is allocated
+// unless a capacity is set; while off every call is a test of a zero id. Like
+// KeyRepeater, the caller supplies the time.
+//
+// Records are opened on the task that runs the HTTP server and stamped by the
+// main loop when triggers fire there. A stamp for a record that was reused in
+// the meantime is dropped, and a dump taken mid-update may show a record one
+// stamp behind.
+class KeyTrace {
+ public:
+  static const uint16_t MAX_CAPACITY = 1024;
+
+  void set_capacity(uint16_t capacity) {
+    delete[] records_;
+    records_ = nullptr;
+    capacity_ = capacity < MAX_CAPACITY ? capacity : MAX_CAPACITY;
+    if (capacity_ != 0)
+      records_ = new TraceRecord[capacity_]();
+    recorded_ = 0;
+  }
+  uint16_t get_capacity() const { return capacity_; }
+  // Pauses and resumes recording without freeing the ring
+  void set_enabled(bool enabled) { enabled_ = enabled; }
+  bool enabled() const { return records_ != nullptr && enabled_; }
+
+  // Opens a record for the key request being handled on a connection and
+  // returns its id, which the later stages are stamped with.
+  uint32_t begin(uint8_t connection, uint32_t start_us, uint32_t parsed_us, uint8_t route, uint8_t flags) {
+    uint32_t seq = ++recorded_;
+    TraceRecord &record = records_[(seq - 1) % capacity_];
+    record.seq = 0;  // Invalidates late stamps for the previous occupant
+    record.start_us = start_us;
+    for (uint32_t &stage : record.stage_us)
+      stage = TRACE_NOT_REACHED;
+    record.stage_us[TRACE_PARSED] = parsed_us - start_us;
+    record.route = route;
+    record.key = 0;
+    record.type = 0;
+    record.flags = flags;
+    record.seq = seq;
+    if (connection < EcpHttpServer::MAX_CONNECTIONS)
+      open_[connection] = seq;
+    return seq;
+  }
+  // The request being handled on a connection isn't traced
+  void skip(uint8_t connection) {
+    if (connection < EcpHttpServer::MAX_CONNECTIONS)
+      open_[connection] = 0;
+  }
+
+  void stamp(uint32_t id, TraceStage stage, uint32_t now_us) {
+    TraceRecord *record = find_(id);
+    if (record != nullptr)
+      record->stage_us[stage] = now_us - record->start_us;
+  }
+  void set_key(uint32_t id, uint8_t key, uint8_t type) {
+    TraceRecord *record = find_(id);
+    if (record != nullptr) {
+      record->key = key;
+      record->type = type;
+    }
+  }
+  void add_flags(uint32_t id, uint8_t flags) {
+    TraceRecord *record = find_(id);
+    if (record != nullptr)
+      record->flags |= flags;
+  }
+
+  // From the response hook: the answer on a connection went out elapsed_us
+  // after its request began
+  void finish(uint8_t connection, uint32_t elapsed_us) {
+    if (connection >= EcpHttpServer::MAX_CONNECTIONS || open_[connection] == 0)
+      return;
+    TraceRecord *record = find_(open_[connection]);
+    if (record != nullptr)
+      record->stage_us[TRACE_SENT] = elapsed_us;
+    open_[connection] = 0;
+  }
+
+  // Oldest and count of the records a dump taken now would hold
+  uint32_t oldest() const { return recorded_ > capacity_ ? recorded_ - capacity_ + 1 : 1; }
+  uint16_t count() const { return recorded_ < capacity_ ? recorded_ : capacity_; }
+
+  // Renders piece `index` of a dump of `count` records starting at seq
+  // `first`, for send_chunked(): the header, then as many whole records as
+  // fit in each piece.
+  int write(uint16_t index, uint32_t first, uint16_t count, uint32_t now_us, char *out, size_t len) const {
+    if (index == 0) {
+      TraceHeader header{{'R', 'K', 'T', 'R'}, 1, TRACE_STAGE_COUNT, sizeof(TraceRecord), capacity_, count, now_us};
+      memcpy(out, &header, sizeof(header));
+      return sizeof(header);
+    }
+    size_t per_piece = len / sizeof(TraceRecord);
+    size_t begin = (index - 1) * per_piece;
+    if (begin >= count)
+      return -1;
+    size_t n = count - begin < per_piece ? count - begin : per_piece;
+    for (size_t i = 0; i < n; i++) {
+      // A record overwritten since the dump started goes out as it is now;
+      // the decoder tells by its seq
+      memcpy(out + i * sizeof(TraceRecord), &records_[(first - 1 + begin + i) % capacity_], sizeof(TraceRecord));
+    }
+    return n * sizeof(TraceRecord);
+  }
+
+ protected:
+  TraceRecord *find_(uint32_t id) {
+    if (id == 0)
+      return nullptr;
+    TraceRecord &record = records_[(id - 1) % capacity_];
+    return record.seq == id ? &record : nullptr;
+  }
+
+  TraceRecord *records_{nullptr};
+  uint16_t capacity_{0};
+  bool enabled_{true};
+  uint32_t recorded_{0};
+  uint32_t open_[EcpHttpServer::MAX_CONNECTIONS]{};  // By connection slot, the record awaiting its response
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
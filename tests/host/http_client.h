@@ -0,0 +1,65 @@
+#pragma once
+
+// A non-blocking HTTP client for tests that run the component on the same
+// thread: the request goes out at once and pump() (usually the component's
+// loop()) is called until the server closes the connection.
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+// A non-blocking connection to the server on 127.0.0.1, or -1. Loopback
+// connects complete in the kernel, the server accepts later.
+inline int http_connect(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  return fd;
+}
+
+// Sends request as given, which should ask for Connection: close, and returns
+// everything received. Empty on a connect failure or after timeout_ms.
+template<typename Pump>
+std::string http_exchange(uint16_t port, const std::string &request, Pump pump, uint32_t timeout_ms = 2000) {
+  int fd = http_connect(port);
+  if (fd < 0)
+    return "";
+  send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+
+  std::string response;
+  auto start = std::chrono::steady_clock::now();
+  char buffer[1024];
+  for (;;) {
+    pump();
+    ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+    if (len > 0) {
+      response.append(buffer, len);
+      continue;
+    }
+    if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+      break;
+    if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(timeout_ms)) {
+      response.clear();
+      break;
+    }
+  }
+  close(fd);
+  return response;
+}
+
+inline std::string get_request(const char *path) {
+  return std::string("GET ") + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+}
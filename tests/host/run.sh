@@ -0,0 +1,34 @@
+#!/bin/sh
+# Builds and runs the host tests against the component headers, with small
+# stand-ins for the parts of ESPHome core it uses (stubs/). Needs g++ and a
+# Linux host; the network tests use the loopback interface.
+#
+#   tests/host/run.sh                  # all tests
+#   tests/host/run.sh test_key_repeat  # one test
+#   SANITIZE=1 tests/host/run.sh       # with AddressSanitizer and UBSan
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$HERE/../.." && pwd)
+OUT=${OUT:-$HERE/build}
+CXX=${CXX:-g++}
+FLAGS="-std=gnu++17 -O2 -g -Wall -Wextra -DUSE_HOST -pthread"
+if [ -n "$SANITIZE" ]; then
+  FLAGS="$FLAGS -fsanitize=address,undefined -fno-sanitize-recover=undefined"
+fi
+
+mkdir -p "$OUT"
+if [ $# -gt 0 ]; then
+  TESTS="$*"
+else
+  TESTS=$(cd "$HERE" && ls test_*.cpp | sed 's/\.cpp$//')
+fi
+
+failed=0
+for test in $TESTS; do
+  $CXX $FLAGS -I"$HERE/stubs" -I"$ROOT" -o "$OUT/$test" "$HERE/$test.cpp" "$HERE/stubs/stubs.cpp"
+  if ! "$OUT/$test"; then
+    failed=$((failed + 1))
+  fi
+done
+[ $failed -eq 0 ] || { echo "$failed test(s) failed"; exit 1; }
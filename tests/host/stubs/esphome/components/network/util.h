@@ -0,0 +1,19 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+namespace esphome {
+namespace network {
+
+struct IPAddress {
+  bool is_set() const { return false; }
+  std::string str() const { return ""; }
+};
+using IPAddresses = std::array<IPAddress, 5>;
+
+bool is_connected();
+IPAddresses get_ip_addresses();
+
+}  // namespace network
+}  // namespace esphome
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+namespace esphome {
+
+template<typename... Ts> class CallbackManager;
+template<typename... Ts> class CallbackManager<void(Ts...)> {
+ public:
+  void add(std::function<void(Ts...)> &&callback) { callbacks_.push_back(std::move(callback)); }
+  void call(Ts... args) {
+    for (auto &callback : callbacks_)
+      callback(args...);
+  }
+  size_t size() const { return callbacks_.size(); }
+
+ protected:
+  std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+template<typename... Ts> class Trigger {
+ public:
+  void trigger(Ts...) {}
+};
+
+}  // namespace esphome
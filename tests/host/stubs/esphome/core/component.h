@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+
+namespace setup_priority {
+const float AFTER_WIFI = 250.0f;
+const float AFTER_CONNECTION = 100.0f;
+}  // namespace setup_priority
+
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return 0.0f; }
+};
+
+class PollingComponent : public Component {
+ public:
+  virtual void update() = 0;
+};
+
+}  // namespace esphome
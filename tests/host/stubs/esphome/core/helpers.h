@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+
+uint32_t random_uint32();
+void get_mac_address_raw(uint8_t *mac);
+
+class HighFrequencyLoopRequester {
+ public:
+  void start() { started_ = true; }
+  void stop() { started_ = false; }
+  bool is_started() const { return started_; }
+
+ protected:
+  bool started_{false};
+};
+
+}  // namespace esphome
@@ -0,0 +1,35 @@
+// The parts of ESPHome core the component uses, for host tests
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/components/network/util.h"
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace esphome {
+
+static const auto START = std::chrono::steady_clock::now();
+
+uint32_t millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - START).count();
+}
+uint32_t micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - START).count();
+}
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+uint32_t random_uint32() {
+  static std::mt19937 generator(1);
+  return generator();
+}
+void get_mac_address_raw(uint8_t *mac) {
+  for (uint8_t i = 0; i < 6; i++)
+    mac[i] = 0x10 + i;
+}
+
+namespace network {
+bool is_connected() { return true; }
+IPAddresses get_ip_addresses() { return {}; }
+}  // namespace network
+
+}  // namespace esphome
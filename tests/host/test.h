@@ -0,0 +1,28 @@
+#pragma once
+
+// Just enough of a test framework for the host tests: CHECK() records a
+// failure and carries on, TEST_RESULT() reports and sets the exit code.
+#include <cstdio>
+
+static int test_failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      test_failures++; \
+    } \
+  } while (0)
+
+#define CHECK_EQ(actual, expected) \
+  do { \
+    long long actual_ = (long long) (actual); \
+    long long expected_ = (long long) (expected); \
+    if (actual_ != expected_) { \
+      std::printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, actual_, expected_); \
+      test_failures++; \
+    } \
+  } while (0)
+
+#define TEST_RESULT() \
+  (std::printf("%s: %s\n", __FILE__, test_failures == 0 ? "passed" : "FAILED"), test_failures == 0 ? 0 : 1)
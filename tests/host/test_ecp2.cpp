@@ -0,0 +1,71 @@
+// ECP-2 request parsing stays inside the message it's given. Each message is
+// copied into a heap block of exactly its length, without a NUL, so a read
+// past the end shows up under SANITIZE=1.
+#include "esphome/components/emulated_roku/ecp2.h"
+#include "test.h"
+#include <cstdlib>
+#include <string>
+
+using namespace esphome::emulated_roku;
+
+// The fields are copied out before the block is freed
+struct Parsed {
+  bool ok;
+  std::string request;
+  std::string key;
+};
+
+static Parsed parse(const std::string &message) {
+  char *block = (char *) malloc(message.size() ? message.size() : 1);
+  memcpy(block, message.data(), message.size());
+  Ecp2Request request;
+  Parsed parsed{parse_ecp2_request(block, message.size(), &request), "", ""};
+  if (request.request != nullptr)
+    parsed.request = request.request;
+  if (request.param_key != nullptr)
+    parsed.key = request.param_key;
+  free(block);
+  return parsed;
+}
+
+static void test_fields() {
+  Parsed p = parse(R"({"request":"key-press","request-id":"7","param-key":"Lit_\u00e9", "n": 5})");
+  CHECK(p.ok);
+  CHECK(p.request == "key-press");
+  CHECK(p.key == "Lit_\xC3\xA9");
+}
+
+static void test_truncated_messages() {
+  const std::string whole = R"({"request":"key-press","param-key":"Home\n"})";
+  for (size_t len = 0; len < whole.size(); len++) {
+    // Every prefix parses or fails without reading past its end
+    Parsed p = parse(whole.substr(0, len));
+    if (len == 0)
+      CHECK(!p.ok);
+  }
+  // Cut inside a value: the field isn't taken
+  Parsed p = parse(R"({"request":"key-press","param-key":"Ho)");
+  CHECK(!p.ok);
+  // Cut inside an escape
+  CHECK(!parse(R"({"param-key":"\u00)").ok);
+  CHECK(!parse(R"({"param-key":"\)").ok);
+}
+
+static void test_length_bounds_the_parse() {
+  // Whatever follows len in the buffer is not part of the message
+  const std::string message = R"({"request":"key-press","param-key":"Up"})";
+  std::string buffer = message + R"("param-key":"Down"})";
+  char *block = (char *) malloc(buffer.size());
+  memcpy(block, buffer.data(), buffer.size());
+  Ecp2Request request;
+  CHECK(parse_ecp2_request(block, message.size(), &request));
+  CHECK(request.param_key != nullptr && strcmp(request.param_key, "Up") == 0);
+  free(block);
+}
+
+int main() {
+  test_fields();
+  test_truncated_messages();
+  test_length_bounds_the_parse();
+  return TEST_RESULT();
+}
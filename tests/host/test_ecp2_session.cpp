@@ -0,0 +1,122 @@
+// The ECP-2 handshake over a real WebSocket on loopback: keys and launches
+// are refused with 401 until the client answers the challenge correctly, and
+// a wrong answer is refused rather than let through.
+#include "http_client.h"
+#include "test.h"
+#include "test_roku.h"
+#include <string>
+
+using namespace esphome::emulated_roku;
+
+static const uint16_t PORT = 18066;
+
+static TestRoku roku(PORT);
+static uint32_t key_events = 0;
+
+static void pump() { roku.loop(); }
+
+// Reads until the buffer holds one complete unmasked server frame, returns its payload
+static std::string receive_message(int fd, std::string &buffer) {
+  for (int i = 0; i < 20000; i++) {
+    pump();
+    char chunk[512];
+    ssize_t len = recv(fd, chunk, sizeof(chunk), 0);
+    if (len > 0)
+      buffer.append(chunk, len);
+    if (buffer.size() >= 2) {
+      size_t payload = (uint8_t) buffer[1] & 0x7F;
+      size_t header = 2;
+      if (payload == 126 && buffer.size() >= 4) {
+        payload = ((uint8_t) buffer[2] << 8) | (uint8_t) buffer[3];
+        header = 4;
+      }
+      if (buffer.size() >= header + payload) {
+        std::string message = buffer.substr(header, payload);
+        buffer.erase(0, header + payload);
+        return message;
+      }
+    }
+  }
+  return "";
+}
+
+// Clients mask what they send
+static void send_message(int fd, const std::string &message) {
+  std::string frame = "\x81";
+  frame += (char) (0x80 | message.size());
+  const char mask[4] = {0x11, 0x22, 0x33, 0x44};
+  frame.append(mask, 4);
+  for (size_t i = 0; i < message.size(); i++)
+    frame += (char) (message[i] ^ mask[i % 4]);
+  send(fd, frame.data(), frame.size(), MSG_NOSIGNAL);
+}
+
+static std::string request(int fd, std::string &buffer, const std::string &message) {
+  send_message(fd, message);
+  return receive_message(fd, buffer);
+}
+
+static bool has_code(const std::string &response, const char *code) {
+  return response.find(std::string("\"response-code\":\"") + code + "\"") != std::string::npos;
+}
+
+// The challenge is the value of param-challenge in the first message
+static std::string challenge_of(const std::string &notify) {
+  size_t start = notify.find("\"param-challenge\":\"");
+  if (start == std::string::npos)
+    return "";
+  start += 19;
+  return notify.substr(start, notify.find('"', start) - start);
+}
+
+static void test_authentication_required() {
+  int fd = http_connect(PORT);
+  CHECK(fd >= 0);
+  if (fd < 0)
+    return;
+  const char *upgrade = "GET /ecp-session HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\n"
+                        "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                        "Sec-WebSocket-Protocol: ecp-2\r\nSec-WebSocket-Version: 13\r\n\r\n";
+  send(fd, upgrade, strlen(upgrade), MSG_NOSIGNAL);
+  std::string buffer;
+  for (int i = 0; i < 20000 && buffer.find("\r\n\r\n") == std::string::npos; i++) {
+    pump();
+    char chunk[512];
+    ssize_t len = recv(fd, chunk, sizeof(chunk), 0);
+    if (len > 0)
+      buffer.append(chunk, len);
+  }
+  CHECK(buffer.compare(0, 12, "HTTP/1.1 101") == 0);
+  buffer.erase(0, buffer.find("\r\n\r\n") + 4);
+  std::string challenge = challenge_of(receive_message(fd, buffer));
+  CHECK(!challenge.empty());
+
+  const std::string key_press = R"({"request":"key-press","request-id":"2","param-key":"Select"})";
+  const std::string launch = R"({"request":"launch","request-id":"3","param-channel-id":"12"})";
+  CHECK(has_code(request(fd, buffer, key_press), "401"));
+  CHECK(has_code(request(fd, buffer, launch), "401"));
+
+  // A wrong answer, then none at all, leave the session unauthenticated
+  CHECK(has_code(request(fd, buffer, R"({"request":"authenticate","request-id":"4","param-response":"bm9wZQ=="})"),
+                 "401"));
+  CHECK(has_code(request(fd, buffer, R"({"request":"authenticate","request-id":"5"})"), "401"));
+  CHECK(has_code(request(fd, buffer, key_press), "401"));
+  CHECK_EQ(key_events, 0);
+
+  char expected[29];
+  ecp2_expected_response(challenge.c_str(), expected);
+  CHECK(has_code(request(fd, buffer,
+                         std::string(R"({"request":"authenticate","request-id":"6","param-response":")") +
+                             expected + "\"}"),
+                 "200"));
+  CHECK(has_code(request(fd, buffer, key_press), "200"));
+  CHECK_EQ(key_events, 1);
+  close(fd);
+}
+
+int main() {
+  roku.add_on_key_event_callback([](RokuKeyEvent) { key_events++; });
+  roku.start();
+  test_authentication_required();
+  return TEST_RESULT();
+}
@@ -0,0 +1,126 @@
+// The high-frequency loop is only requested while the sockets are busy. Once
+// a burst of requests is over, loop() lets it go after the tail and keeps it
+// off, both with every connection slot held by an idle keep-alive client and
+// with every slot held by a client stalled mid-request while another waits in
+// the listen backlog.
+#include "http_client.h"
+#include "test.h"
+#include "test_roku.h"
+#include <thread>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::emulated_roku;
+
+static const uint16_t PORT = 18065;
+
+static TestRoku roku(PORT);
+
+// Calls loop() every millisecond, as the fast loop would, until done() holds
+// or timeout_ms passes
+template<typename Done> static bool loop_until(Done done, uint32_t timeout_ms) {
+  uint32_t start = millis();
+  while (!done()) {
+    if (millis() - start > timeout_ms)
+      return false;
+    roku.loop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+// Opens a keep-alive connection and reads the response to one request on it
+static int open_idle_connection() {
+  int fd = http_connect(PORT);
+  if (fd < 0)
+    return -1;
+  const char *request = "GET /query/active-app HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+  send(fd, request, strlen(request), MSG_NOSIGNAL);
+  std::string response;
+  bool answered = loop_until(
+      [&] {
+        char buffer[1024];
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+        if (len > 0)
+          response.append(buffer, len);
+        return response.find("</active-app>") != std::string::npos;
+      },
+      2000);
+  CHECK(answered);
+  CHECK(response.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+  return fd;
+}
+
+// After the last traffic the fast loop is released within the tail, and
+// loop() then runs without finding more. Startup NOTIFYs loop back to the
+// responder's own socket and count as traffic, which the timeout allows for;
+// it stays below the request timeout that would free stalled slots.
+static void check_released() {
+  bool released = loop_until([] { return !roku.fast_loop_requested(); }, EcpHttpServer::REQUEST_TIMEOUT - 1000);
+  CHECK(released);
+  CHECK(millis() - roku.last_io() >= HIGH_FREQUENCY_TAIL);
+  uint32_t quiet_since = roku.last_io();
+  loop_until([] { return false; }, 300);
+  if (roku.last_io() == quiet_since)
+    CHECK(!roku.fast_loop_requested());
+}
+
+static bool still_open(int fd) {
+  char buffer[64];
+  return recv(fd, buffer, sizeof(buffer), 0) < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+static void test_released_with_idle_connections() {
+  std::vector<int> fds;
+  for (uint8_t i = 0; i < EcpHttpServer::MAX_CONNECTIONS; i++)
+    fds.push_back(open_idle_connection());
+  CHECK(roku.fast_loop_requested());
+  check_released();
+  for (int fd : fds) {
+    CHECK(still_open(fd));
+    close(fd);
+  }
+}
+
+static void test_released_with_stalled_connections() {
+  std::vector<int> fds;
+  const char *partial = "GET /query/device-info HTTP/1.1\r\nHost: 127.0.0.1\r\n";
+  for (uint8_t i = 0; i < EcpHttpServer::MAX_CONNECTIONS; i++) {
+    int fd = http_connect(PORT);
+    CHECK(fd >= 0);
+    send(fd, partial, strlen(partial), MSG_NOSIGNAL);
+    fds.push_back(fd);
+  }
+  loop_until([] { return false; }, 100);  // Accepts them and reads what they sent
+  // No slot is free or idle for this one, it stays in the backlog
+  int waiting = http_connect(PORT);
+  CHECK(waiting >= 0);
+  check_released();
+  for (int fd : fds) {
+    CHECK(still_open(fd));
+    close(fd);
+  }
+
+  // The waiting client is served once the slots are free again
+  const char *request = "GET /query/active-app HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+  send(waiting, request, strlen(request), MSG_NOSIGNAL);
+  std::string response;
+  CHECK(loop_until(
+      [&] {
+        char buffer[1024];
+        ssize_t len = recv(waiting, buffer, sizeof(buffer), 0);
+        if (len > 0)
+          response.append(buffer, len);
+        return len == 0;
+      },
+      2000));
+  CHECK(response.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+  close(waiting);
+}
+
+int main() {
+  roku.start();
+  test_released_with_idle_connections();
+  test_released_with_stalled_connections();
+  return TEST_RESULT();
+}
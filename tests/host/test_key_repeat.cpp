@@ -0,0 +1,144 @@
+// KeyRepeater on a simulated clock: the cadence of repeats, what happens when
+// the loop runs late or irregularly, the release timeout, and millis() wrap.
+#include "esphome/components/emulated_roku/key_repeat.h"
+#include "test.h"
+#include <random>
+#include <vector>
+
+using namespace esphome::emulated_roku;
+
+static const uint32_t DELAY = 500;
+static const uint32_t INTERVAL = 100;
+static const uint32_t RELEASE_TIMEOUT = 2000;
+
+// Drives a repeater and records what it generated, by simulated time
+struct Harness {
+  KeyRepeater repeater;
+  uint32_t now;
+  std::vector<uint32_t> repeats;
+  std::vector<uint32_t> releases;
+
+  explicit Harness(uint32_t start) : now(start) { repeater.configure(DELAY, INTERVAL, RELEASE_TIMEOUT); }
+
+  bool down(const char *name) { return repeater.key_down(parse_roku_key(ROKU_KEY_EVENT_DOWN, name), name, now); }
+  bool up(const char *name) { return repeater.key_up(parse_roku_key(ROKU_KEY_EVENT_UP, name)); }
+
+  // Runs the loop every `step` ms until `duration` has passed
+  void run(uint32_t duration, uint32_t step = 1) {
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += step) {
+      now += step;
+      repeater.loop(
+          now, [this](const RokuKeyEvent &, const char *) { repeats.push_back(now); },
+          [this](const RokuKeyEvent &event, const char *) {
+            CHECK(event.type == ROKU_KEY_EVENT_UP);
+            releases.push_back(now);
+          });
+    }
+  }
+};
+
+// First repeat after the delay, then one per interval, none after keyup
+static void test_cadence(uint32_t start) {
+  Harness h(start);
+  CHECK(h.down("Up"));
+  h.run(DELAY + 5 * INTERVAL);
+  CHECK_EQ(h.repeats.size(), 6);
+  for (size_t i = 0; i < h.repeats.size(); i++)
+    CHECK_EQ(h.repeats[i] - start, DELAY + i * INTERVAL);
+  CHECK(h.up("Up"));
+  CHECK(!h.repeater.active());
+  h.run(1000);
+  CHECK_EQ(h.repeats.size(), 6);
+  CHECK(!h.up("Up"));
+}
+
+// Loop calls at irregular times still give one repeat per deadline, each
+// within one loop step of it, without drifting
+static void test_jitter() {
+  std::mt19937 random(7);
+  Harness h(1000);
+  h.repeater.configure(DELAY, INTERVAL, 0);  // No release during the long hold
+  h.down("Right");
+  uint32_t start = h.now;
+  while (h.now - start < DELAY + 50 * INTERVAL)
+    h.run(1 + random() % (INTERVAL / 2), 1 + random() % (INTERVAL / 2));
+  CHECK_EQ(h.repeats.size(), 51);
+  for (size_t i = 0; i < h.repeats.size(); i++) {
+    uint32_t deadline = start + DELAY + i * INTERVAL;
+    CHECK(h.repeats[i] >= deadline && h.repeats[i] - deadline < INTERVAL / 2);
+  }
+  CHECK_EQ(h.repeater.get_stats().coalesced, 0);
+}
+
+// A loop that stalls for several intervals sends one repeat, not a burst
+static void test_stall_coalesces() {
+  Harness h(0);
+  h.down("Down");
+  h.run(DELAY);  // First repeat
+  h.run(5 * INTERVAL + 10, 5 * INTERVAL + 10);
+  // Five deadlines passed, one repeat stands for them
+  CHECK_EQ(h.repeats.size(), 2);
+  CHECK_EQ(h.repeater.get_stats().coalesced, 4);
+  // Back to the cadence from the late repeat
+  uint32_t late = h.repeats.back();
+  h.run(INTERVAL);
+  CHECK_EQ(h.repeats.size(), 3);
+  CHECK_EQ(h.repeats.back(), late + INTERVAL);
+}
+
+// Released with a synthetic keyup release_timeout after the only keydown
+static void test_auto_release() {
+  Harness h(0);
+  h.down("Select");
+  h.run(RELEASE_TIMEOUT + 500);
+  CHECK_EQ(h.releases.size(), 1);
+  CHECK_EQ(h.releases[0], RELEASE_TIMEOUT);
+  CHECK(!h.repeater.active());
+  CHECK_EQ(h.repeater.get_stats().auto_released, 1);
+}
+
+// A hub resending keydown while the button is held keeps the key held far
+// past the timeout; the timeout counts from the last of those keydowns
+static void test_keydowns_keep_key_held() {
+  Harness h(0);
+  CHECK(h.down("VolumeUp"));
+  for (int i = 0; i < 8; i++) {
+    h.run(RELEASE_TIMEOUT / 2);
+    CHECK(!h.down("VolumeUp"));  // Not passed on again
+  }
+  uint32_t last_keydown = h.now;
+  CHECK(h.releases.empty());
+  CHECK(h.repeater.active());
+  h.run(RELEASE_TIMEOUT + 500);
+  CHECK_EQ(h.releases.size(), 1);
+  CHECK_EQ(h.releases[0] - last_keydown, RELEASE_TIMEOUT);
+  // Repeats kept their cadence through the duplicate keydowns
+  uint32_t held = h.releases[0] - 1;
+  CHECK_EQ(h.repeats.size(), (held - DELAY) / INTERVAL + 1);
+}
+
+// Keys are held independently, and only MAX_HELD_KEYS repeat
+static void test_several_keys() {
+  Harness h(0);
+  const char *const KEYS[] = {"Up", "Down", "Left", "Right", "Select"};
+  for (const char *key : KEYS)
+    CHECK(h.down(key));
+  CHECK_EQ(h.repeater.held_count(), KeyRepeater::MAX_HELD_KEYS);
+  CHECK(!h.up("Select"));
+  CHECK(h.up("Left"));
+  CHECK_EQ(h.repeater.held_count(), KeyRepeater::MAX_HELD_KEYS - 1);
+  CHECK(h.down("Lit_a"));
+  CHECK(h.down("Lit_b"));  // Another literal is another key, but the table is full again
+  CHECK(!h.down("Lit_a"));
+}
+
+int main() {
+  test_cadence(0);
+  test_cadence(0xFFFFFFFF - 300);  // millis() wraps during the hold
+  test_jitter();
+  test_stall_coalesces();
+  test_auto_release();
+  test_keydowns_keep_key_held();
+  test_several_keys();
+  return TEST_RESULT();
+}
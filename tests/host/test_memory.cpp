@@ -0,0 +1,110 @@
+// Heap held by the device description and device-info bodies, and the peak
+// the request path adds while serving them. operator new is replaced to keep
+// a running total of live bytes.
+#include "http_client.h"
+#include "test.h"
+#include "test_roku.h"
+#include <cstdlib>
+#include <new>
+
+static const size_t HEADER = alignof(std::max_align_t);
+static size_t live_bytes = 0;
+static size_t peak_bytes = 0;
+
+void *operator new(size_t size) {
+  char *block = (char *) malloc(size + HEADER);
+  if (block == nullptr)
+    throw std::bad_alloc();
+  *(size_t *) block = size;
+  live_bytes += size;
+  peak_bytes = live_bytes > peak_bytes ? live_bytes : peak_bytes;
+  return block + HEADER;
+}
+void operator delete(void *ptr) noexcept {
+  if (ptr == nullptr)
+    return;
+  char *block = (char *) ptr - HEADER;
+  live_bytes -= *(size_t *) block;
+  free(block);
+}
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+using namespace esphome::emulated_roku;
+
+static const uint16_t PORT = 18063;
+
+class MeasuredRoku : public TestRoku {
+ public:
+  MeasuredRoku() : TestRoku(PORT) {}
+  // Heap the two bodies keep, measured by building them from nothing
+  size_t rebuild_responses() {
+    device_description_.reset();
+    device_info_.reset();
+    size_t before = live_bytes;
+    build_responses();
+    return live_bytes - before;
+  }
+  // Largest heap growth during any one loop() call
+  size_t loop_peak{0};
+  void measured_loop() {
+    size_t before = live_bytes;
+    peak_bytes = live_bytes;
+    loop();
+    size_t grown = peak_bytes - before;
+    loop_peak = grown > loop_peak ? grown : loop_peak;
+  }
+};
+
+static size_t count(const std::string &haystack, const std::string &needle) {
+  size_t found = 0;
+  for (size_t at = haystack.find(needle); at != std::string::npos; at = haystack.find(needle, at + 1))
+    found++;
+  return found;
+}
+
+static void test_memory() {
+  // The longest name __init__.py accepts, so nothing may be cut short
+  std::string name(MAX_DEVICE_NAME_LENGTH, 'n');
+  static MeasuredRoku roku;
+  roku.set_device_name(name);
+  roku.start();
+  auto pump = [] { roku.measured_loop(); };
+
+  size_t resident = roku.rebuild_responses();
+  std::printf("device description and device-info: %zu bytes resident\n", resident);
+  // Two TemplateResponses and their shared_ptr control blocks, nothing else
+  CHECK(resident <= 2 * (sizeof(TemplateResponse) + 64));
+
+  std::string description, info;
+  for (int i = 0; i < 20; i++) {
+    description = http_exchange(PORT, get_request("/"), pump);
+    info = http_exchange(PORT, get_request("/query/device-info"), pump);
+  }
+  CHECK(description.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+  CHECK(info.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+  CHECK_EQ(count(description, "<friendlyName>" + name + "</friendlyName>"), 1);
+  // Friendly, default and user device names
+  CHECK_EQ(count(info, ">" + name + "<"), 3);
+
+  std::printf("peak heap growth while serving them: %zu bytes\n", roku.loop_peak);
+  CHECK_EQ(roku.loop_peak, 0);
+
+  // A rename after start reaches the bodies through the serving task
+  roku.set_device_name("Renamed");
+  description = http_exchange(PORT, get_request("/"), pump);
+  CHECK_EQ(count(description, "<friendlyName>Renamed</friendlyName>"), 1);
+
+  // A name too long for the arena is cut between characters, not inside one
+  std::string accented = "x";
+  for (int i = 0; i < 60; i++)
+    accented += "\xC3\xA9";
+  roku.set_device_name(accented);
+  description = http_exchange(PORT, get_request("/"), pump);
+  CHECK_EQ(count(description, "<friendlyName>" + accented.substr(0, MAX_DEVICE_NAME_LENGTH - 1) + "</friendlyName>"),
+           1);
+}
+
+int main() {
+  test_memory();
+  return TEST_RESULT();
+}
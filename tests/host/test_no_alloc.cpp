@@ -0,0 +1,94 @@
+// The request path never touches the heap: operator new is replaced to count
+// calls made from inside loop() while every ECP route is served over loopback.
+// Startup (the server, the responder) is left out by a warm-up round.
+#include "http_client.h"
+#include "test.h"
+#include "test_roku.h"
+#include <cstdlib>
+#include <new>
+
+static bool counting = false;
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  if (counting)
+    allocations++;
+  void *ptr = malloc(size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+using namespace esphome::emulated_roku;
+
+static const uint16_t PORT = 18064;
+
+static TestRoku roku(PORT);
+static uint32_t key_events = 0;
+static uint32_t key_presses = 0;
+
+static void counted_loop() {
+  counting = true;
+  roku.loop();
+  counting = false;
+}
+
+static std::string post_request(const char *path) {
+  return std::string("POST ") + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+}
+
+static bool ok(const std::string &response, const char *status = "HTTP/1.1 200") {
+  return response.compare(0, strlen(status), status) == 0;
+}
+
+// One request to every route, plus a conditional GET and a pipelined pair
+static void serve_all_routes() {
+  static const char *const GETS[] = {"/", "/query/device-info", "/query/apps", "/query/active-app",
+                                     "/query/icon/12", "/query/emulated-stats", "/query/trace"};
+  static const char *const POSTS[] = {"/keypress/Home", "/keydown/Up", "/keyup/Up", "/keypress/Lit_a",
+                                      "/keypress/Lit_%C3%A9", "/launch/12", "/input?text=abc",
+                                      "/search/browse?keyword=news"};
+  for (const char *path : GETS)
+    CHECK(ok(http_exchange(PORT, get_request(path), counted_loop)));
+  for (const char *path : POSTS)
+    CHECK(ok(http_exchange(PORT, post_request(path), counted_loop)));
+
+  std::string info = http_exchange(PORT, get_request("/query/device-info"), counted_loop);
+  size_t etag = info.find("ETag: ");
+  CHECK(etag != std::string::npos);
+  std::string conditional = "GET /query/device-info HTTP/1.1\r\nHost: 127.0.0.1\r\nIf-None-Match: " +
+                            info.substr(etag + 6, info.find("\r\n", etag) - etag - 6) +
+                            "\r\nConnection: close\r\n\r\n";
+  CHECK(ok(http_exchange(PORT, conditional, counted_loop), "HTTP/1.1 304"));
+
+  std::string pipelined = "POST /keypress/Select HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 0\r\n\r\n" +
+                          get_request("/query/active-app");
+  std::string both = http_exchange(PORT, pipelined, counted_loop);
+  CHECK(ok(both));
+  CHECK(both.find("<active-app>") != std::string::npos);
+}
+
+static void test_request_path_does_not_allocate() {
+  roku.set_trace_size(16);
+  // Both key triggers; key names fit std::string's inline buffer
+  roku.add_on_key_event_callback([](RokuKeyEvent) { key_events++; });
+  roku.add_on_key_press_callback([](std::string, std::string) { key_presses++; });
+  roku.start();
+  serve_all_routes();  // Warm-up
+  allocations = 0;
+  uint32_t keys_before = key_events;
+  for (int round = 0; round < 3; round++)
+    serve_all_routes();
+  std::printf("allocations in loop() over 3 rounds of every route: %zu\n", allocations);
+  CHECK_EQ(allocations, 0);
+  // Six key requests per round reached the triggers
+  CHECK_EQ(key_events - keys_before, 3 * 6);
+  CHECK(key_presses >= key_events);
+}
+
+int main() {
+  test_request_path_does_not_allocate();
+  return TEST_RESULT();
+}
@@ -0,0 +1,95 @@
+// How long hubs wait to learn a new Location after an address change. The
+// component serves from a second thread as the ESP32 network task does, and
+// the change reaches it the way check_network() hands it over. The test
+// listens as a notify target on 127.0.0.1:1900, next to the responder's own
+// socket on the wildcard address.
+#include "test.h"
+#include "test_roku.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace esphome::emulated_roku;
+
+static const uint16_t PORT = 18062;
+
+static int listen_ssdp() {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(1900);
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  struct timeval tv = {0, 100000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  return fd;
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Waits for a datagram containing every one of the strings, up to timeout_ms
+static bool receive(int fd, const char *a, const char *b, double timeout_ms) {
+  auto start = std::chrono::steady_clock::now();
+  char buffer[1024];
+  while (elapsed_ms(start) < timeout_ms) {
+    ssize_t len = recv(fd, buffer, sizeof(buffer) - 1, 0);
+    if (len <= 0)
+      continue;
+    buffer[len] = '\0';
+    if (strstr(buffer, a) != nullptr && strstr(buffer, b) != nullptr)
+      return true;
+  }
+  return false;
+}
+
+static void test_rediscovery_after_address_change() {
+  int fd = listen_ssdp();
+  CHECK(fd >= 0);
+  if (fd < 0)
+    return;
+
+  static TestRoku roku(PORT);
+  roku.add_notify_target("127.0.0.1");
+  roku.start();
+  roku.start_task();
+  CHECK(roku.change_address("127.0.0.1"));
+  CHECK(receive(fd, "ssdp:alive", "Location: http://127.0.0.1:18062/", 2000));
+
+  static const char *const ADDRESSES[] = {"127.0.0.2", "127.0.0.3"};
+  static const int CHANGES = 8;
+  double total_ms = 0, worst_ms = 0;
+  for (int i = 0; i < CHANGES; i++) {
+    // Each change lands at a different point of the task's select() wait
+    std::this_thread::sleep_for(std::chrono::milliseconds(50 + 7 * i));
+    const char *ip = ADDRESSES[i % 2];
+    char location[48];
+    snprintf(location, sizeof(location), "Location: http://%s:%u/", ip, PORT);
+    auto changed = std::chrono::steady_clock::now();
+    CHECK(roku.change_address(ip));
+    CHECK(receive(fd, "ssdp:byebye", "roku:ecp", 1000));
+    CHECK(receive(fd, "ssdp:alive", location, 1000));
+    double ms = elapsed_ms(changed);
+    total_ms += ms;
+    worst_ms = ms > worst_ms ? ms : worst_ms;
+  }
+  std::printf("new Location announced %.1f ms after an address change (mean of %d), %.1f ms at most\n",
+              total_ms / CHANGES, CHANGES, worst_ms);
+  // Within one select() timeout of the task, not a NOTIFY interval
+  CHECK(worst_ms < 5 * NETWORK_TASK_WAIT_MS);
+
+  roku.stop_task();
+  close(fd);
+}
+
+int main() {
+  test_rediscovery_after_address_change();
+  return TEST_RESULT();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// The component as the host tests run it: on a port of the test's own, with
+// the network always up, and with a way into the state the serving task owns.
+// Tests keep it in a static, components live for the whole program as on the
+// device.
+#include "esphome/components/emulated_roku/emulated_roku.h"
+#include <atomic>
+#include <thread>
+
+namespace esphome {
+namespace emulated_roku {
+
+class TestRoku : public EmulatedRokuComponent {
+ public:
+  explicit TestRoku(uint16_t port) { set_port(port); }
+
+  // Sets up and starts the servers, which the first loop() does once the
+  // network is up
+  void start() {
+    setup();
+    loop();
+  }
+
+  // Serves from a second thread from now on, as the ESP32 network task does
+  void start_task() {
+    network_task_running_ = true;
+    task_ = std::thread([this] {
+      while (!stop_)
+        poll_network(NETWORK_TASK_WAIT_MS);
+    });
+  }
+  void stop_task() {
+    stop_ = true;
+    task_.join();
+  }
+
+  // Whether loop() left the high-frequency loop requested, and when the
+  // sockets last had traffic
+  bool fast_loop_requested() const { return high_freq_.is_started(); }
+  uint32_t last_io() const { return last_io_; }
+
+  // What check_network() queues after reading the interfaces, here a single
+  // Ethernet interface on ip
+  bool change_address(const char *ip) {
+    NetInterfaces interfaces;
+    uint8_t mac[6] = {0x02, 0, 0, 0, 0, 1};
+    interfaces.add(inet_addr(ip), inet_addr("255.0.0.0"), mac, true);
+    return network_queue_.push(interfaces);
+  }
+
+ protected:
+  std::thread task_;
+  std::atomic<bool> stop_{false};
+};
+
+}  // namespace emulated_roku
+}  // namespace esphome
@@ -0,0 +1,108 @@
+// SpscQueue between two real threads, and the key event hand-off from a
+// network task to the main loop that it carries.
+#include "esphome/components/emulated_roku/emulated_roku.h"
+#include "test.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace esphome::emulated_roku;
+
+// Every item arrives exactly once and in order, whatever the interleaving;
+// a full queue refuses items rather than overwriting unread ones.
+static void test_order_under_contention() {
+  static const uint32_t COUNT = 200000;
+  SpscQueue<uint32_t, 16> queue;
+  std::atomic<bool> bad_size{false};
+
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < COUNT;) {
+      if (queue.push(i)) {
+        i++;
+      } else {
+        std::this_thread::yield();  // Also lets this run on a single core
+      }
+      if (queue.size() > queue.capacity())
+        bad_size = true;
+    }
+  });
+  uint32_t expected = 0;
+  uint32_t out_of_order = 0;
+  while (expected < COUNT) {
+    uint32_t item;
+    if (queue.pop(item)) {
+      if (item != expected)
+        out_of_order++;
+      expected++;
+    } else {
+      std::this_thread::yield();
+    }
+    // Read from the consumer side while the producer pushes
+    if (queue.size() > queue.capacity())
+      bad_size = true;
+  }
+  producer.join();
+
+  CHECK_EQ(out_of_order, 0);
+  CHECK(!bad_size);
+  CHECK_EQ(queue.size(), 0);
+  CHECK(queue.high_water() <= queue.capacity());
+  CHECK(queue.overflows() > 0);  // The producer outran the consumer at least once
+}
+
+// Whole structs come out as they went in, never half written
+static void test_key_events() {
+  static const uint32_t COUNT = 200000;
+  SpscQueue<QueuedKeyEvent, 16> queue;
+
+  std::thread network_task([&] {
+    for (uint32_t i = 0; i < COUNT;) {
+      QueuedKeyEvent item{};
+      item.event.type = ROKU_KEY_EVENT_PRESS;
+      item.event.key = (RokuKey) (1 + i % ROKU_KEY_LIT);
+      snprintf(item.name, sizeof(item.name), "%u", (unsigned) i);
+      item.trace_id = i;
+      if (queue.push(item)) {
+        i++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  uint32_t torn = 0;
+  for (uint32_t expected = 0; expected < COUNT;) {
+    QueuedKeyEvent item;
+    if (!queue.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    char name[sizeof(item.name)];
+    snprintf(name, sizeof(name), "%u", (unsigned) expected);
+    if (item.trace_id != expected || item.event.key != 1 + expected % ROKU_KEY_LIT || strcmp(item.name, name) != 0)
+      torn++;
+    expected++;
+  }
+  network_task.join();
+  CHECK_EQ(torn, 0);
+}
+
+static void test_single_thread_limits() {
+  SpscQueue<int, 4> queue;
+  for (int i = 0; i < 4; i++)
+    CHECK(queue.push(i));
+  CHECK(!queue.push(4));
+  CHECK_EQ(queue.size(), 4);
+  CHECK_EQ(queue.overflows(), 1);
+  CHECK_EQ(queue.high_water(), 4);
+  int item = -1;
+  CHECK(queue.pop(item));
+  CHECK_EQ(item, 0);
+  CHECK_EQ(queue.size(), 3);
+}
+
+int main() {
+  test_single_thread_limits();
+  test_order_under_contention();
+  test_key_events();
+  return TEST_RESULT();
+}
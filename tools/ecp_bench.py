@@ -0,0 +1,422 @@
+#!/usr/bin/env python3
+"""Latency and throughput benchmark for an emulated Roku.
+
+Runs against any device speaking ECP, but is meant for the host build
+(see host.yaml) so hot-path regressions show up as numbers:
+
+    esphome run esphome/host.yaml &
+    tools/ecp_bench.py --host 127.0.0.1
+
+Five measurements are taken:
+  keypress     round-trip time of POST /keypress/<key>, optionally from
+               several concurrent clients. The trigger fires before the
+               response is sent, so this bounds keypress-to-trigger latency.
+  ssdp         time from sending an M-SEARCH to receiving the reply.
+  device-info  requests per second for GET /query/device-info.
+  text         types a string as one /keypress/Lit_<char> per character and
+               reads /query/emulated-stats to count the trigger runs and
+               trigger time it cost. With on_text_input configured the
+               characters are assembled into a single text event.
+  ecp2         sends the same keypresses over HTTP (a connection per key,
+               as hubs do) and over one authenticated ECP-2 WebSocket, and
+               compares round-trip time and the server-side time per key from
+               /query/emulated-stats. With --pid (host build only) the
+               server's CPU time per key is read from /proc as well.
+  idle         host build only, needs --pid. The server's CPU use while
+               nothing talks to it, and again while every connection slot
+               holds a half-sent request and one more client waits in the
+               listen backlog (the server should sleep in both cases). Then
+               the round-trip time of a keypress sent after the server has
+               been quiet long enough to drop back to the slow loop.
+"""
+
+import argparse
+import base64
+import hashlib
+import json
+import os
+import re
+import socket
+import struct
+import statistics
+import threading
+import time
+
+
+def percentile(samples, pct):
+    if not samples:
+        return float("nan")
+    ordered = sorted(samples)
+    index = min(len(ordered) - 1, int(round(pct / 100.0 * (len(ordered) - 1))))
+    return ordered[index]
+
+
+def report(name, samples_ms, extra=""):
+    if not samples_ms:
+        print(f"{name:<14} no successful samples {extra}")
+        return
+    print(
+        f"{name:<14} n={len(samples_ms):<6} "
+        f"p50={percentile(samples_ms, 50):7.2f}ms "
+        f"p90={percentile(samples_ms, 90):7.2f}ms "
+        f"p99={percentile(samples_ms, 99):7.2f}ms "
+        f"max={max(samples_ms):7.2f}ms "
+        f"mean={statistics.mean(samples_ms):7.2f}ms {extra}"
+    )
+
+
+def http_request(host, port, method, path, timeout, body=None):
+    """Sends one request on a fresh connection and returns the status code,
+    or with body=True, the status code and the response body."""
+    with socket.create_connection((host, port), timeout=timeout) as sock:
+        sock.sendall(
+            f"{method} {path} HTTP/1.1\r\nHost: {host}:{port}\r\n"
+            f"Content-Length: 0\r\nConnection: close\r\n\r\n".encode()
+        )
+        data = b""
+        while True:
+            chunk = sock.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+    status_line = data.split(b"\r\n", 1)[0].split()
+    status = int(status_line[1]) if len(status_line) > 1 else 0
+    if body:
+        return status, data.split(b"\r\n\r\n", 1)[-1].decode(errors="replace")
+    return status
+
+
+def run_clients(clients, count, work):
+    """Runs work() count times spread over the given number of threads."""
+    samples = []
+    errors = [0]
+    lock = threading.Lock()
+
+    def worker(n):
+        for _ in range(n):
+            start = time.perf_counter()
+            try:
+                ok = work()
+            except OSError:
+                ok = False
+            elapsed = (time.perf_counter() - start) * 1000.0
+            with lock:
+                if ok:
+                    samples.append(elapsed)
+                else:
+                    errors[0] += 1
+
+    per_client = max(1, count // clients)
+    threads = [threading.Thread(target=worker, args=(per_client,)) for _ in range(clients)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return samples, errors[0]
+
+
+def bench_keypress(args):
+    def work():
+        return http_request(args.host, args.port, "POST", f"/keypress/{args.key}", args.timeout) == 200
+
+    samples, errors = run_clients(args.clients, args.requests, work)
+    report("keypress", samples, f"clients={args.clients} errors={errors}")
+
+
+def bench_ssdp(args):
+    search = (
+        "M-SEARCH * HTTP/1.1\r\n"
+        "HOST: 239.255.255.250:1900\r\n"
+        'MAN: "ssdp:discover"\r\n'
+        "ST: roku:ecp\r\n"
+        "\r\n"
+    ).encode()
+    samples = []
+    errors = 0
+    for _ in range(args.ssdp_searches):
+        # A new source port per search, so replies are never coalesced
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+            sock.settimeout(args.timeout)
+            start = time.perf_counter()
+            sock.sendto(search, (args.host, args.ssdp_port))
+            try:
+                sock.recvfrom(1024)
+                samples.append((time.perf_counter() - start) * 1000.0)
+            except socket.timeout:
+                errors += 1
+    report("ssdp", samples, f"timeouts={errors}")
+
+
+def bench_device_info(args):
+    deadline = time.perf_counter() + args.duration
+    completed = [0]
+    errors = [0]
+    lock = threading.Lock()
+
+    def worker():
+        while time.perf_counter() < deadline:
+            try:
+                ok = http_request(args.host, args.port, "GET", "/query/device-info", args.timeout) == 200
+            except OSError:
+                ok = False
+            with lock:
+                if ok:
+                    completed[0] += 1
+                else:
+                    errors[0] += 1
+
+    threads = [threading.Thread(target=worker) for _ in range(args.clients)]
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    elapsed = time.perf_counter() - start
+    print(
+        f"{'device-info':<14} {completed[0] / elapsed:8.1f} req/s "
+        f"clients={args.clients} errors={errors[0]}"
+    )
+
+
+def read_trigger_stats(args):
+    """Returns (runs, total microseconds) of the key-trigger histogram."""
+    _, stats = http_request(args.host, args.port, "GET", "/query/emulated-stats", args.timeout, body=True)
+    match = re.search(r'<dispatch name="key-triggers" count="(\d+)" mean-us="(\d+)"', stats)
+    if match is None:
+        return 0, 0
+    count, mean = int(match.group(1)), int(match.group(2))
+    return count, count * mean
+
+
+def read_route_stats(args, route):
+    """Returns (count, mean microseconds) of one route's latency histogram."""
+    _, stats = http_request(args.host, args.port, "GET", "/query/emulated-stats", args.timeout, body=True)
+    match = re.search(rf'<route name="{route}" count="(\d+)" mean-us="(\d+)"', stats)
+    if match is None:
+        return 0, 0
+    return int(match.group(1)), int(match.group(2))
+
+
+def cpu_seconds(pid):
+    """User plus system CPU time of a local process, None without a pid."""
+    if pid is None:
+        return None
+    with open(f"/proc/{pid}/stat") as stat:
+        fields = stat.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+class Ecp2Client:
+    """Just enough of a WebSocket client to run an ECP-2 session."""
+
+    # The published key; clients map each hex digit n to (24 - n) % 16
+    AUTH_KEY = "95E610D0-7C29-44EF-FB0F-97F1FCE4C297"
+
+    def __init__(self, host, port, timeout):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.buf = b""
+        self.request_id = 0
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(
+            f"GET /ecp-session HTTP/1.1\r\nHost: {host}:{port}\r\nUpgrade: websocket\r\n"
+            f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n"
+            f"Sec-WebSocket-Protocol: ecp-2\r\n\r\n".encode()
+        )
+        while b"\r\n\r\n" not in self.buf:
+            self._fill()
+        head, self.buf = self.buf.split(b"\r\n\r\n", 1)
+        if b" 101 " not in head.split(b"\r\n", 1)[0]:
+            raise OSError("WebSocket upgrade refused")
+        challenge = self.receive()["param-challenge"]
+        transformed = "".join(
+            f"{(24 - int(c, 16)) % 16:X}" if c in "0123456789ABCDEF" else c for c in self.AUTH_KEY
+        )
+        digest = hashlib.sha1((challenge + transformed).encode()).digest()
+        reply = self.request("authenticate", **{"param-response": base64.b64encode(digest).decode()})
+        if reply.get("response-code") != "200":
+            raise OSError("ECP-2 authentication failed")
+
+    def _fill(self):
+        chunk = self.sock.recv(4096)
+        if not chunk:
+            raise OSError("connection closed")
+        self.buf += chunk
+
+    def receive(self):
+        while True:
+            if len(self.buf) >= 2:
+                length, header = self.buf[1] & 0x7F, 2
+                if length == 126 and len(self.buf) >= 4:
+                    length, header = struct.unpack(">H", self.buf[2:4])[0], 4
+                if length < 126 and len(self.buf) >= header + length:
+                    opcode, payload = self.buf[0] & 0x0F, self.buf[header : header + length]
+                    self.buf = self.buf[header + length :]
+                    if opcode == 1:
+                        return json.loads(payload)
+                    if opcode == 8:
+                        raise OSError("session closed")
+                    continue
+            self._fill()
+
+    def request(self, name, **params):
+        self.request_id += 1
+        message = json.dumps({"request": name, "request-id": str(self.request_id), **params}).encode()
+        mask = os.urandom(4)
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(message))
+        self.sock.sendall(bytes([0x81, 0x80 | len(message)]) + mask + masked)
+        return self.receive()
+
+    def close(self):
+        self.sock.close()
+
+
+def bench_ecp2(args):
+    count = args.requests
+
+    def measure(route, send_key):
+        before = read_route_stats(args, route)
+        cpu_before = cpu_seconds(args.pid)
+        samples, errors = [], 0
+        for _ in range(count):
+            start = time.perf_counter()
+            try:
+                ok = send_key()
+            except OSError:
+                ok = False
+            if ok:
+                samples.append((time.perf_counter() - start) * 1000.0)
+            else:
+                errors += 1
+        cpu_after = cpu_seconds(args.pid)
+        after = read_route_stats(args, route)
+        # Server-side time of just these requests, from the running means
+        served = after[0] - before[0]
+        server_us = (after[0] * after[1] - before[0] * before[1]) / served if served else float("nan")
+        extra = f"server={server_us:.0f}us/key errors={errors}"
+        if cpu_before is not None:
+            extra += f" cpu={(cpu_after - cpu_before) * 1e6 / max(1, len(samples)):.0f}us/key"
+        report(route, samples, extra)
+
+    measure(
+        "keypress",
+        lambda: http_request(args.host, args.port, "POST", f"/keypress/{args.key}", args.timeout) == 200,
+    )
+    client = Ecp2Client(args.host, args.port, args.timeout)
+    try:
+        measure(
+            "ecp-session",
+            lambda: client.request("key-press", **{"param-key": args.key}).get("response-code") == "200",
+        )
+    finally:
+        client.close()
+
+
+def bench_text(args):
+    before_runs, before_us = read_trigger_stats(args)
+    start = time.perf_counter()
+    errors = 0
+    for char in args.text:
+        path = "/keypress/Lit_" + "".join(f"%{b:02X}" if not chr(b).isalnum() else chr(b) for b in char.encode())
+        if http_request(args.host, args.port, "POST", path, args.timeout) != 200:
+            errors += 1
+    typed_ms = (time.perf_counter() - start) * 1000.0
+    # Let the debounce window close so an assembled text has been delivered
+    time.sleep(args.text_settle)
+    after_runs, after_us = read_trigger_stats(args)
+    runs = after_runs - before_runs
+    print(
+        f"{'text':<14} chars={len(args.text):<4} trigger-runs={runs:<4} "
+        f"trigger-time={after_us - before_us}us typed-in={typed_ms:.1f}ms errors={errors}"
+    )
+
+
+def bench_idle(args):
+    if args.pid is None:
+        print(f"{'idle':<14} skipped, needs --pid")
+        return
+
+    def cpu_share(seconds):
+        before = cpu_seconds(args.pid)
+        time.sleep(seconds)
+        return (cpu_seconds(args.pid) - before) * 100.0 / seconds
+
+    # Let the fast loop from earlier traffic run out first
+    time.sleep(args.wake_gap)
+    print(f"{'idle':<14} cpu={cpu_share(args.idle_time):5.2f}%")
+
+    # Gap plus sample stay below the server's 5 s request timeout, which would
+    # free the slots
+    held = []
+    try:
+        for _ in range(args.slots + 1):
+            sock = socket.create_connection((args.host, args.port), timeout=args.timeout)
+            sock.sendall(f"GET /query/device-info HTTP/1.1\r\nHost: {args.host}\r\n".encode())
+            held.append(sock)
+        time.sleep(args.wake_gap)
+        print(f"{'slots-full':<14} cpu={cpu_share(min(args.idle_time, 3.0)):5.2f}% connections={len(held)}")
+    finally:
+        for sock in held:
+            sock.close()
+
+    samples = []
+    errors = 0
+    for _ in range(args.wakes):
+        time.sleep(args.wake_gap)
+        start = time.perf_counter()
+        try:
+            ok = http_request(args.host, args.port, "POST", f"/keypress/{args.key}", args.timeout) == 200
+        except OSError:
+            ok = False
+        if ok:
+            samples.append((time.perf_counter() - start) * 1000.0)
+        else:
+            errors += 1
+    report("wake", samples, f"gap={args.wake_gap}s errors={errors}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8060, help="ECP HTTP port")
+    parser.add_argument("--ssdp-port", type=int, default=1900)
+    parser.add_argument("--clients", type=int, default=4, help="concurrent HTTP clients")
+    parser.add_argument("--requests", type=int, default=400, help="keypress requests in total")
+    parser.add_argument("--ssdp-searches", type=int, default=50)
+    parser.add_argument("--duration", type=float, default=5.0, help="seconds of device-info load")
+    parser.add_argument("--key", default="Select")
+    parser.add_argument("--timeout", type=float, default=2.0)
+    parser.add_argument("--text", default="the quick brown fox!", help="string typed by the text benchmark")
+    parser.add_argument(
+        "--text-settle", type=float, default=1.5, help="seconds to wait for the text debounce window"
+    )
+    parser.add_argument("--pid", type=int, help="server process, to read its CPU time (ecp2 and idle)")
+    parser.add_argument("--idle-time", type=float, default=5.0, help="seconds of CPU sampling while idle")
+    parser.add_argument("--slots", type=int, default=4, help="server connection slots to fill (idle benchmark)")
+    parser.add_argument("--wakes", type=int, default=10, help="keypresses sent after a quiet gap")
+    parser.add_argument(
+        "--wake-gap", type=float, default=1.5, help="quiet seconds before each wake-up keypress"
+    )
+    parser.add_argument(
+        "--only",
+        choices=["keypress", "ssdp", "device-info", "text", "ecp2", "idle"],
+        action="append",
+        help="run a subset (repeatable)",
+    )
+    args = parser.parse_args()
+
+    benches = {
+        "keypress": bench_keypress,
+        "ssdp": bench_ssdp,
+        "device-info": bench_device_info,
+        "text": bench_text,
+        "ecp2": bench_ecp2,
+        "idle": bench_idle,
+    }
+    for name, bench in benches.items():
+        if args.only is None or name in args.only:
+            bench(args)
+
+
+if __name__ == "__main__":
+    main()
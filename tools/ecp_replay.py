@@ -0,0 +1,626 @@
+#!/usr/bin/env python3
+"""Replays recorded SSDP/ECP sessions against an emulated Roku, and fuzzes it.
+
+Meant for the host build (see host.yaml), like ecp_bench.py:
+
+    esphome run esphome/host.yaml &
+    tools/ecp_replay.py run tools/sessions/harmony_activity.txt --sessions 8
+    tools/ecp_replay.py fuzz --cases 2000
+    tools/ecp_replay.py convert capture.pcap > session.txt
+
+Session format
+--------------
+One event per line, '#' starts a comment. Each line is a time in
+milliseconds from the start of the session, an event and its arguments.
+Raw payloads are one word: Python escapes, with spaces as \\x20 and '#' as
+\\x23:
+
+    0     search roku:ecp 1        M-SEARCH for ST roku:ecp with MX 1
+    150   http GET /query/device-info
+    900   http POST /keypress/VolumeUp
+    2000  close                    drop the session's HTTP connection
+    2100  ssdp M-SEARCH\\x20*\\x20HTTP/1.1\\r\\n...   a raw datagram
+    2200  raw GET\\x20/\\x20HTTP/1.1\\r\\n\\r\\n     raw bytes on the HTTP connection
+
+HTTP events share one kept-alive connection per session, opened on demand,
+as a hub does. `convert` produces `ssdp` and `raw` lines from a capture.
+
+run
+---
+Starts --sessions copies of each session file at once (staggered over the
+first second), --loops times each, with the recorded gaps divided by
+--speed. Reports throughput, per-route latency, SSDP reply times and
+errors, then compares what was sent with what /query/emulated-stats says
+the device counted and dispatched, to show dropped key events.
+
+fuzz
+----
+Sends malformed and oversized HTTP requests and M-SEARCH datagrams, and
+checks after every --probe-every cases that the device still answers both
+a normal request and a normal search. With --pid it also notices the
+process dying.
+"""
+
+import argparse
+import os
+import random
+import re
+import socket
+import struct
+import sys
+import threading
+import time
+
+from ecp_bench import report
+
+SSDP_GROUP = "239.255.255.250"
+
+
+def m_search(st, mx):
+    return (
+        "M-SEARCH * HTTP/1.1\r\n"
+        f"HOST: {SSDP_GROUP}:1900\r\n"
+        'MAN: "ssdp:discover"\r\n'
+        f"ST: {st}\r\n"
+        f"MX: {mx}\r\n"
+        "\r\n"
+    ).encode()
+
+
+def unescape(text):
+    return text.encode("latin-1").decode("unicode_escape").encode("latin-1")
+
+
+def escape(data):
+    text = data.decode("latin-1").encode("unicode_escape").decode("ascii")
+    return text.replace(" ", "\\x20").replace("#", "\\x23")
+
+
+def load_session(path):
+    events = []
+    with open(path) as session:
+        for number, line in enumerate(session, 1):
+            fields = line.split("#", 1)[0].split()
+            if not fields:
+                continue
+            if len(fields) < 2:
+                raise SystemExit(f"{path}:{number}: expected '<ms> <event> ...'")
+            at, kind, rest = float(fields[0]), fields[1], fields[2:]
+            if kind == "search":
+                st, mx = (rest + ["roku:ecp", "1"][len(rest) :])[:2]
+                events.append((at, "ssdp", m_search(st, mx)))
+            elif kind in ("ssdp", "raw") and len(rest) == 1:
+                events.append((at, kind, unescape(rest[0])))
+            elif kind == "http" and len(rest) == 2:
+                events.append((at, "http", (rest[0], rest[1])))
+            elif kind == "close":
+                events.append((at, "close", None))
+            else:
+                raise SystemExit(f"{path}:{number}: can't parse '{kind}' event")
+    events.sort(key=lambda event: event[0])
+    return events
+
+
+def route_of(path):
+    """Groups paths the way the device's route table does."""
+    segments = path.split("?", 1)[0].strip("/").split("/")
+    if segments[0] in ("keypress", "keydown", "keyup", "launch"):
+        return segments[0]
+    if segments[0] == "query" and len(segments) > 1:
+        return "icon" if segments[1] == "icon" else segments[1]
+    return segments[0] or "root"
+
+
+def read_response(sock, buf):
+    """Reads one HTTP response off a kept-alive socket. Returns (status,
+    keep_alive, rest of the buffer)."""
+    while b"\r\n\r\n" not in buf:
+        chunk = sock.recv(4096)
+        if not chunk:
+            raise OSError("connection closed before the response")
+        buf += chunk
+    head, buf = buf.split(b"\r\n\r\n", 1)
+    lines = head.decode("latin-1").split("\r\n")
+    status_line = lines[0].split()
+    status = int(status_line[1]) if len(status_line) > 1 and status_line[1].isdigit() else 0
+    headers = {}
+    for line in lines[1:]:
+        name, _, value = line.partition(":")
+        headers[name.strip().lower()] = value.strip()
+    keep_alive = headers.get("connection", "").lower() != "close" and status_line[0] == "HTTP/1.1"
+
+    if headers.get("transfer-encoding", "").lower() == "chunked":
+        while True:
+            while b"\r\n" not in buf:
+                buf += sock.recv(4096)
+            size_line, buf = buf.split(b"\r\n", 1)
+            size = int(size_line.split(b";")[0], 16)
+            while len(buf) < size + 2:
+                chunk = sock.recv(4096)
+                if not chunk:
+                    raise OSError("connection closed mid-body")
+                buf += chunk
+            buf = buf[size + 2 :]
+            if size == 0:
+                break
+    elif "content-length" in headers:
+        length = int(headers["content-length"])
+        while len(buf) < length:
+            chunk = sock.recv(4096)
+            if not chunk:
+                raise OSError("connection closed mid-body")
+            buf += chunk
+        buf = buf[length:]
+    elif status not in (101, 204, 304):
+        # Body runs until the connection closes
+        while sock.recv(4096):
+            pass
+        keep_alive = False
+    return status, keep_alive, buf
+
+
+class Results:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.http = {}  # route -> [ms]
+        self.statuses = {}
+        self.sent_keys = {}  # route -> count sent
+        self.acked_keys = {}  # route -> count answered 2xx
+        self.ssdp = []
+        self.ssdp_sent = 0
+        self.errors = {}
+        self.connections = 0
+        self.reconnects = 0  # Requests retried because the device had closed an idle connection
+
+    def error(self, kind):
+        with self.lock:
+            self.errors[kind] = self.errors.get(kind, 0) + 1
+
+
+class SessionPlayer:
+    def __init__(self, args, events, results):
+        self.args = args
+        self.events = events
+        self.results = results
+        self.sock = None
+        self.buf = b""
+        self.udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.udp.settimeout(0)
+        self.pending_searches = []
+
+    def run(self, start_delay):
+        time.sleep(start_delay)
+        try:
+            for _ in range(self.args.loops):
+                start = time.perf_counter()
+                for at, kind, data in self.events:
+                    delay = start + at / 1000.0 / self.args.speed - time.perf_counter()
+                    if delay > 0:
+                        self.collect_ssdp(delay)
+                    self.play(kind, data)
+                self.close()
+            self.collect_ssdp(self.args.ssdp_wait)
+        finally:
+            self.close()
+            self.udp.close()
+
+    def play(self, kind, data):
+        if kind == "ssdp":
+            self.udp.sendto(data, (self.args.host, self.args.ssdp_port))
+            with self.results.lock:
+                self.results.ssdp_sent += 1
+            if data.startswith(b"M-SEARCH"):
+                self.pending_searches.append(time.perf_counter())
+        elif kind == "close":
+            self.close()
+        elif kind == "http":
+            method, path = data
+            request = (
+                f"{method} {path} HTTP/1.1\r\nHost: {self.args.host}:{self.args.port}\r\n"
+                f"Content-Length: 0\r\n\r\n"
+            ).encode()
+            self.exchange(request, route_of(path))
+        elif kind == "raw":
+            self.exchange(data, "raw")
+
+    def exchange(self, request, route):
+        is_key = route in ("keypress", "keydown", "keyup")
+        if is_key:
+            with self.results.lock:
+                self.results.sent_keys[route] = self.results.sent_keys.get(route, 0) + 1
+        start = time.perf_counter()
+        for attempt in range(2):
+            reused = self.sock is not None
+            try:
+                if self.sock is None:
+                    self.sock = socket.create_connection((self.args.host, self.args.port), timeout=self.args.timeout)
+                    self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                    self.buf = b""
+                    with self.results.lock:
+                        self.results.connections += 1
+                self.sock.sendall(request)
+                status, keep_alive, self.buf = read_response(self.sock, self.buf)
+                break
+            except socket.timeout:
+                self.results.error("timeout")
+                self.close()
+                return
+            except OSError:
+                self.close()
+                if not reused or attempt == 1:
+                    self.results.error("connection")
+                    return
+                # The device closed the idle connection (timeout or eviction
+                # to make room); like any HTTP client, retry on a new one
+                with self.results.lock:
+                    self.results.reconnects += 1
+        elapsed = (time.perf_counter() - start) * 1000.0
+        with self.results.lock:
+            self.results.http.setdefault(route, []).append(elapsed)
+            self.results.statuses[status] = self.results.statuses.get(status, 0) + 1
+            if is_key and 200 <= status < 300:
+                self.results.acked_keys[route] = self.results.acked_keys.get(route, 0) + 1
+        if not keep_alive:
+            self.close()
+
+    def collect_ssdp(self, duration):
+        """Sleeps for duration, picking up search replies meanwhile."""
+        deadline = time.perf_counter() + duration
+        while True:
+            remaining = deadline - time.perf_counter()
+            if remaining <= 0:
+                return
+            self.udp.settimeout(remaining)
+            try:
+                self.udp.recvfrom(2048)
+            except (socket.timeout, BlockingIOError):
+                return
+            except OSError:
+                return
+            if self.pending_searches:
+                sent = self.pending_searches.pop(0)
+                with self.results.lock:
+                    self.results.ssdp.append((time.perf_counter() - sent) * 1000.0)
+
+    def close(self):
+        if self.sock is not None:
+            self.sock.close()
+            self.sock = None
+
+
+def fetch_stats(args):
+    """Counters from /query/emulated-stats: route and dispatch counts plus the
+    key-queue overflows. Empty if the page can't be read."""
+    try:
+        with socket.create_connection((args.host, args.port), timeout=args.timeout) as sock:
+            sock.sendall(b"GET /query/emulated-stats HTTP/1.1\r\nConnection: close\r\n\r\n")
+            data = b""
+            while True:
+                chunk = sock.recv(4096)
+                if not chunk:
+                    break
+                data += chunk
+    except OSError:
+        return {}
+    text = data.decode(errors="replace")
+    stats = {}
+    for _, name, count in re.findall(r'<(route|dispatch) name="([^"]+)" count="(\d+)"', text):
+        stats[name] = int(count)
+    counters = (("key-queue", "overflows"), ("ssdp", "searches"), ("ssdp", "answered"), ("key-repeat", "coalesced"))
+    for name, attr in counters:
+        match = re.search(rf'<{name} [^>]*{attr}="(\d+)"', text)
+        if match:
+            stats[f"{name}.{attr}"] = int(match.group(1))
+    return stats
+
+
+def command_run(args):
+    sessions = [load_session(path) for path in args.session]
+    results = Results()
+    before = fetch_stats(args)
+    rng = random.Random(args.seed)
+    threads = []
+    for events in sessions:
+        for _ in range(args.sessions):
+            player = SessionPlayer(args, events, results)
+            threads.append(threading.Thread(target=player.run, args=(rng.random() if args.sessions > 1 else 0,)))
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    elapsed = time.perf_counter() - start
+    after = fetch_stats(args)
+
+    requests = sum(len(samples) for samples in results.http.values())
+    print(
+        f"{len(threads)} session(s), {requests} HTTP requests on {results.connections} connection(s) "
+        f"in {elapsed:.1f}s ({requests / elapsed:.1f} req/s), {results.ssdp_sent} SSDP datagrams"
+    )
+    for route in sorted(results.http):
+        report(route, results.http[route])
+    report("ssdp-reply", results.ssdp, f"searches-answered={len(results.ssdp)}")
+    statuses = " ".join(f"{code}={count}" for code, count in sorted(results.statuses.items()))
+    errors = " ".join(f"{kind}={count}" for kind, count in sorted(results.errors.items())) or "none"
+    print(f"status codes: {statuses or '-'}  errors: {errors}  reconnects: {results.reconnects}")
+
+    if not before or not after:
+        print("device counters: /query/emulated-stats unavailable")
+        return
+
+    def delta(name):
+        return after.get(name, 0) - before.get(name, 0)
+
+    # Anything acknowledged but not counted or dispatched was lost on the way
+    # to the triggers; Lit_ keys folded into text by on_text_input show up as
+    # fewer dispatches too
+    for route in sorted(results.sent_keys):
+        print(
+            f"{route:<14} sent={results.sent_keys[route]} acked={results.acked_keys.get(route, 0)} "
+            f"device-counted={delta(route)}"
+        )
+    print(
+        f"{'dispatch':<14} key-trigger-runs={delta('key-triggers')} "
+        f"key-queue-overflows={delta('key-queue.overflows')}"
+    )
+    print(f"{'ssdp':<14} searches-seen={delta('ssdp.searches')} replies-sent={delta('ssdp.answered')}")
+
+
+def http_fuzz_case(rng, seeds):
+    """One hostile request: a mutated recorded request or a crafted one."""
+    seed = rng.choice(seeds)
+    choice = rng.randrange(10)
+    if choice == 0:
+        return b"GET /" + b"A" * rng.randrange(900, 5000) + b" HTTP/1.1\r\n\r\n"
+    if choice == 1:
+        return b"GET / HTTP/1.1\r\n" + b"X-Pad: " + b"B" * rng.randrange(900, 3000) + b"\r\n\r\n"
+    if choice == 2:
+        length = rng.choice([b"99999999", b"-1", b"4294967296", b"abc", b"1000"])
+        return b"POST /keypress/Home HTTP/1.1\r\nContent-Length: " + length + b"\r\n\r\nxyz"
+    if choice == 3:
+        return seed * rng.randrange(10, 60)  # Deep pipeline
+    if choice == 4:
+        return seed[: rng.randrange(1, len(seed))]  # Truncated, then closed
+    if choice == 5:
+        return bytes(rng.randrange(256) for _ in range(rng.randrange(1, 1500)))
+    if choice == 6:
+        key = rng.choice([b"Lit_%", b"Lit_%F", b"Lit_%FF%FE%FD%FC", b"Lit_" + b"%41" * 300, b"%00", b""])
+        return b"POST /keypress/" + key + b" HTTP/1.1\r\n\r\n"
+    if choice == 7:
+        return (
+            b"GET /ecp-session HTTP/1.1\r\nUpgrade: websocket\r\nSec-WebSocket-Key: "
+            + rng.choice([b"", b"x" * 100, b"dGhlIHNhbXBsZSBub25jZQ=="])
+            + b"\r\n\r\n"
+            + bytes(rng.randrange(256) for _ in range(rng.randrange(0, 300)))
+        )
+    # Byte-level mutations of a valid request
+    data = bytearray(seed)
+    for _ in range(rng.randrange(1, 8)):
+        op = rng.randrange(3)
+        pos = rng.randrange(len(data)) if data else 0
+        if op == 0 and data:
+            data[pos] = rng.randrange(256)
+        elif op == 1:
+            data[pos:pos] = bytes([rng.choice([0, 10, 13, 32, 37, 47, 58, 63, 255])]) * rng.randrange(1, 20)
+        elif data:
+            del data[pos : pos + rng.randrange(1, 10)]
+    return bytes(data)
+
+
+def ssdp_fuzz_case(rng):
+    """One hostile datagram for the M-SEARCH parser."""
+    base = m_search("roku:ecp", 1)
+    choice = rng.randrange(8)
+    if choice == 0:
+        return base[:-2] + b"X-Pad: " + b"C" * rng.randrange(500, 1400) + b"\r\n\r\n"  # Over the 512-byte buffer
+    if choice == 1:
+        return b"M-SEARCH " + bytes(rng.randrange(256) for _ in range(rng.randrange(0, 600)))
+    if choice == 2:
+        return m_search(rng.choice(["roku:ecp", "ssdp:all", ""]), rng.choice(["-1", "999999", "x", "", "0"]))
+    if choice == 3:
+        return b"M-SEARCH * HTTP/1.1\r\nST:" + b" " * rng.randrange(0, 500)
+    if choice == 4:
+        return b"M-SEARCH * HTTP/1.1\r\n" + b"ST: roku:ecp\r\n" * rng.randrange(1, 40)
+    if choice == 5:
+        return rng.choice([b"", b"M", b"M-SEARCH", b"M-SEARCH ", b"NOTIFY * HTTP/1.1\r\n\r\n"])
+    data = bytearray(base)
+    for _ in range(rng.randrange(1, 6)):
+        pos = rng.randrange(len(data))
+        data[pos] = rng.choice([0, 10, 13, 58, rng.randrange(256)])
+    return bytes(data)
+
+
+def probe(args):
+    """True if the device still answers a normal request and a normal search."""
+    try:
+        with socket.create_connection((args.host, args.port), timeout=args.timeout) as sock:
+            sock.sendall(b"GET /query/device-info HTTP/1.1\r\nConnection: close\r\n\r\n")
+            status, _, _ = read_response(sock, b"")
+            if status != 200:
+                return False
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as udp:
+            udp.settimeout(args.timeout + 1.0)
+            udp.sendto(m_search("roku:ecp", 1), (args.host, args.ssdp_port))
+            udp.recvfrom(2048)
+        return True
+    except OSError:
+        return False
+
+
+def process_alive(pid):
+    if pid is None:
+        return True
+    try:
+        os.kill(pid, 0)
+        return True
+    except OSError:
+        return False
+
+
+def command_fuzz(args):
+    rng = random.Random(args.seed)
+    seeds = [
+        b"POST /keypress/Home HTTP/1.1\r\nHost: roku\r\nContent-Length: 0\r\n\r\n",
+        b"GET /query/device-info HTTP/1.1\r\nHost: roku\r\n\r\n",
+        b"POST /search/browse?keyword=abc&title=x HTTP/1.1\r\n\r\n",
+        b"POST /input?a=b&c HTTP/1.1\r\n\r\n",
+        b"GET /query/icon/12 HTTP/1.1\r\nIf-None-Match: \"abc\"\r\n\r\n",
+    ]
+    for path in args.session or []:
+        for _, kind, data in load_session(path):
+            if kind == "http":
+                seeds.append(f"{data[0]} {data[1]} HTTP/1.1\r\n\r\n".encode())
+            elif kind == "raw":
+                seeds.append(data)
+
+    outcomes = {}
+    failures = 0
+    udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    start = time.perf_counter()
+    for case in range(1, args.cases + 1):
+        if case % 2:
+            request = http_fuzz_case(rng, seeds)
+            try:
+                with socket.create_connection((args.host, args.port), timeout=args.timeout) as sock:
+                    sock.sendall(request)
+                    sock.shutdown(socket.SHUT_WR)
+                    reply = sock.recv(64)
+                    match = re.match(rb"HTTP/1\.[01] (\d{3})", reply)
+                    if match:
+                        outcome = f"http-{match.group(1).decode()}"
+                    else:
+                        outcome = "http-other" if reply else "http-closed"
+            except socket.timeout:
+                outcome = "http-timeout"
+            except OSError:
+                outcome = "http-reset"
+        else:
+            udp.sendto(ssdp_fuzz_case(rng), (args.host, args.ssdp_port))
+            outcome = "ssdp-sent"
+        outcomes[outcome] = outcomes.get(outcome, 0) + 1
+
+        if case % args.probe_every == 0 or case == args.cases:
+            if not process_alive(args.pid):
+                print(f"case {case}: server process {args.pid} died")
+                failures += 1
+                break
+            if not probe(args):
+                failures += 1
+                print(f"case {case}: device stopped answering")
+                if args.stop_on_failure:
+                    break
+    udp.close()
+    elapsed = time.perf_counter() - start
+    summary = " ".join(f"{name}={count}" for name, count in sorted(outcomes.items()))
+    print(f"{args.cases} fuzz cases in {elapsed:.1f}s, seed {args.seed}: {summary}")
+    print("device healthy after every probe" if failures == 0 else f"{failures} failed probe(s)")
+    return 1 if failures else 0
+
+
+def pcap_packets(path):
+    """Yields (timestamp, ipv4 packet) from a classic pcap file with Ethernet,
+    Linux cooked or raw IP framing."""
+    with open(path, "rb") as capture:
+        header = capture.read(24)
+        magic = header[:4]
+        if magic in (b"\xd4\xc3\xb2\xa1", b"\x4d\x3c\xb2\xa1"):
+            endian = "<"
+        elif magic in (b"\xa1\xb2\xc3\xd4", b"\xa1\xb2\x3c\x4d"):
+            endian = ">"
+        else:
+            raise SystemExit(f"{path}: not a pcap file (pcapng isn't supported, convert with editcap -F pcap)")
+        nanos = magic in (b"\x4d\x3c\xb2\xa1", b"\xa1\xb2\x3c\x4d")
+        linktype = struct.unpack(endian + "I", header[20:24])[0]
+        while True:
+            record = capture.read(16)
+            if len(record) < 16:
+                return
+            seconds, fraction, length, _ = struct.unpack(endian + "IIII", record)
+            frame = capture.read(length)
+            stamp = seconds + fraction / (1e9 if nanos else 1e6)
+            if linktype == 1 and frame[12:14] == b"\x08\x00":
+                yield stamp, frame[14:]
+            elif linktype == 113 and frame[14:16] == b"\x08\x00":
+                yield stamp, frame[16:]
+            elif linktype in (101, 228):
+                yield stamp, frame
+
+
+def command_convert(args):
+    """Turns the client side of a capture into a session: every datagram to
+    the SSDP port and every TCP payload to the ECP port, in order, with TCP
+    retransmissions dropped."""
+    first = None
+    seen = set()
+    lines = []
+    for stamp, packet in pcap_packets(args.pcap):
+        if len(packet) < 20 or packet[0] >> 4 != 4:
+            continue
+        header_len = (packet[0] & 0x0F) * 4
+        protocol = packet[9]
+        source = socket.inet_ntoa(packet[12:16])
+        if args.client and source != args.client:
+            continue
+        segment = packet[header_len:]
+        if protocol == 17 and len(segment) >= 8:
+            port = struct.unpack(">H", segment[2:4])[0]
+            if port != args.ssdp_port:
+                continue
+            payload, kind = segment[8:], "ssdp"
+        elif protocol == 6 and len(segment) >= 20:
+            sport, port, seq = struct.unpack(">HHI", segment[:8])
+            if port != args.port:
+                continue
+            payload = segment[(segment[12] >> 4) * 4 :]
+            key = (source, sport, seq)
+            if not payload or key in seen:
+                continue
+            seen.add(key)
+            kind = "raw"
+        else:
+            continue
+        first = stamp if first is None else first
+        lines.append(f"{(stamp - first) * 1000.0:.0f} {kind} {escape(payload)}")
+    print(f"# Converted from {os.path.basename(args.pcap)}")
+    print("\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8060, help="ECP HTTP port")
+    parser.add_argument("--ssdp-port", type=int, default=1900)
+    parser.add_argument("--timeout", type=float, default=2.0)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    run = commands.add_parser("run", help="replay session files")
+    run.add_argument("session", nargs="+")
+    run.add_argument("--sessions", type=int, default=1, help="concurrent copies of each session")
+    run.add_argument("--loops", type=int, default=1, help="times each copy plays its session")
+    run.add_argument("--speed", type=float, default=1.0, help="divide the recorded gaps by this")
+    run.add_argument("--ssdp-wait", type=float, default=1.5, help="seconds to wait for late search replies")
+    run.add_argument("--seed", type=int, default=1, help="for the session start stagger")
+
+    fuzz = commands.add_parser("fuzz", help="send malformed HTTP requests and SSDP datagrams")
+    fuzz.add_argument("--cases", type=int, default=1000)
+    fuzz.add_argument("--seed", type=int, default=1, help="the same seed replays the same cases")
+    fuzz.add_argument("--probe-every", type=int, default=100, help="health check interval in cases")
+    fuzz.add_argument("--session", action="append", help="also mutate the requests of this session file")
+    fuzz.add_argument("--pid", type=int, help="server process, to notice it dying")
+    fuzz.add_argument("--stop-on-failure", action="store_true")
+
+    convert = commands.add_parser("convert", help="extract a session from a pcap capture")
+    convert.add_argument("pcap")
+    convert.add_argument("--client", help="only packets from this IP (the hub)")
+
+    args = parser.parse_args()
+    if args.command == "run":
+        command_run(args)
+    elif args.command == "fuzz":
+        sys.exit(command_fuzz(args))
+    else:
+        command_convert(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,103 @@
+// Key dispatch benchmark: the compile-time key table in keys.h and the
+// RokuKeyEvent callback against the path it replaced, which url-decoded the
+// path segment into a std::string and called the (type, key) string callback,
+// whose trigger copied both strings again. Every key name fits std::string's
+// inline buffer, so the old path only allocates for longer segments; the
+// allocation columns count operator new calls for one dispatch.
+//
+// Builds against the host test stand-ins for ESPHome core:
+//
+//   g++ -std=gnu++17 -O2 -DUSE_HOST -Itests/host/stubs -I. -o key_bench tools/key_bench.cpp tests/host/stubs/stubs.cpp
+//   ./key_bench [dispatches]
+#include "esphome/components/emulated_roku/keys.h"
+#include "esphome/core/automation.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace esphome;
+using namespace esphome::emulated_roku;
+
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  void *ptr = malloc(size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+// The decoder as it was, one string append per character
+static std::string url_decode(const char *str) {
+  std::string decoded;
+  size_t len = strlen(str);
+  char temp[] = "00";
+  for (size_t i = 0; i < len; i++) {
+    if (str[i] == '%' && i + 2 < len) {
+      temp[0] = str[i + 1];
+      temp[1] = str[i + 2];
+      decoded += (char) strtol(temp, nullptr, 16);
+      i += 2;
+    } else if (str[i] == '+') {
+      decoded += ' ';
+    } else {
+      decoded += str[i];
+    }
+  }
+  return decoded;
+}
+
+static const char *const SEGMENTS[] = {
+    "Home",  "Select",     "VolumeUp", "InstantReplay",          "InputHDMI1",
+    "Lit_a", "Lit_%C3%A9", "NotAKey",  "NotAKeyButLongerThan15",
+};
+
+template<typename Dispatch> static double time_dispatches(long count, Dispatch dispatch) {
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < count; i++)
+    dispatch();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+int main(int argc, char **argv) {
+  long count = argc > 1 ? atol(argv[1]) : 2000000;
+  volatile size_t sink = 0;
+
+  // One automation on each path; the string one copies its arguments the way
+  // KeyPressTrigger::trigger() did
+  CallbackManager<void(std::string, std::string)> key_press_callback;
+  key_press_callback.add([&](std::string type, std::string key) {
+    std::string trigger_type = type, trigger_key = key;
+    sink = sink + trigger_type.size() + trigger_key.size();
+  });
+  CallbackManager<void(RokuKeyEvent)> key_event_callback;
+  key_event_callback.add([&](RokuKeyEvent event) { sink = sink + event.key + event.literal[0]; });
+
+  printf("%-24s %10s %10s %12s %12s\n", "segment", "old ns", "table ns", "old allocs", "table allocs");
+  for (const char *name : SEGMENTS) {
+    char segment[32];
+    snprintf(segment, sizeof(segment), "%s", name);
+    // Through a volatile pointer, so the compiler can't hoist the work out
+    char *volatile path = segment;
+
+    auto old_dispatch = [&] { key_press_callback.call(std::string("keypress"), url_decode(path)); };
+    auto new_dispatch = [&] { key_event_callback.call(parse_roku_key(ROKU_KEY_EVENT_PRESS, path)); };
+
+    allocations = 0;
+    old_dispatch();
+    size_t old_allocations = allocations;
+    allocations = 0;
+    new_dispatch();
+    size_t new_allocations = allocations;
+
+    double old_ns = time_dispatches(count, old_dispatch);
+    double new_ns = time_dispatches(count, new_dispatch);
+    printf("%-24s %10.1f %10.1f %12zu %12zu\n", name, old_ns, new_ns, old_allocations, new_allocations);
+  }
+  return 0;
+}
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""Decodes the key event trace of an emulated Roku and shows where the time goes.
+
+The device keeps per-stage timestamps for its last key events when
+`trace_size` is set (host.yaml sets it), and serves them at /query/trace:
+
+    esphome run esphome/host.yaml &
+    tools/ecp_bench.py --only keypress
+    tools/roku_trace.py --host 127.0.0.1
+    tools/roku_trace.py --save trace.bin     # keep the dump for later
+    tools/roku_trace.py --file trace.bin --slowest 10
+
+Every key event is split into the stages it went through, in microseconds:
+
+  receive   request start (accept, or first byte on a kept-alive connection
+            or WebSocket) until the handler ran: waiting for the rest of the
+            request, header parsing, and any wait for the server loop
+  route     matching the path against the route table
+  decode    key lookup and decoding the key name
+  handoff   until the triggers started: the key queue wait when a network
+            task hands events to the main loop, near zero otherwise
+  triggers  on_key_event and on_key_press, i.e. the YAML automations
+  respond   until the last byte of the response was handed to the socket
+  total     request start until both the response and the triggers are done
+
+Events that skip a stage (a Lit_ character collected by on_text_input fires
+no key trigger) are left out of that stage only.
+"""
+
+import argparse
+import os
+import re
+import socket
+import statistics
+import struct
+import sys
+
+HEADER = struct.Struct("<4sBBHHHI")
+MAGIC = b"RKTR"
+NOT_REACHED = 0xFFFFFFFF
+STAGES = ["parsed", "routed", "decoded", "triggers-start", "triggers-end", "sent"]
+FLAG_ECP2 = 1
+FLAG_QUEUED = 2
+EVENT_TYPES = ["press", "down", "up", "repeat"]
+ROUTE_NAMES = {2: "keypress", 3: "keydown", 4: "keyup", 13: "ecp-session"}
+INTERVALS = ["receive", "route", "decode", "handoff", "triggers", "respond", "total"]
+
+
+def key_names():
+    """Key names by RokuKey value, read from the component's keys.h."""
+    path = os.path.join(os.path.dirname(__file__), "..", "esphome", "components", "emulated_roku", "keys.h")
+    try:
+        with open(path) as keys:
+            source = keys.read()
+    except OSError:
+        return {}
+    table = re.search(r"ROKU_KEY_NAMES\[\] = \{(.*?)\};", source, re.S)
+    if table is None:
+        return {}
+    names = re.findall(r'"([^"]*)"', table.group(1))
+    return {i + 1: name for i, name in enumerate(names)}
+
+
+def fetch(host, port, timeout):
+    """The raw /query/trace body. HTTP/1.0 so it comes unchunked, up to the close."""
+    with socket.create_connection((host, port), timeout=timeout) as sock:
+        sock.sendall(f"GET /query/trace HTTP/1.0\r\nHost: {host}:{port}\r\n\r\n".encode())
+        data = b""
+        while True:
+            chunk = sock.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+    head, _, body = data.partition(b"\r\n\r\n")
+    status = head.split(b"\r\n", 1)[0].split()
+    if len(status) < 2 or status[1] != b"200":
+        raise SystemExit(f"/query/trace answered {head.splitlines()[0] if head else 'nothing'}")
+    return body
+
+
+def parse(dump):
+    """Returns (header dict, records), records oldest first without duplicates."""
+    if len(dump) < HEADER.size:
+        raise SystemExit("trace dump is too short")
+    magic, version, stages, record_size, capacity, count, now_us = HEADER.unpack_from(dump)
+    if magic != MAGIC or version != 1:
+        raise SystemExit(f"not a version 1 trace dump (magic {magic!r}, version {version})")
+    record = struct.Struct(f"<I{stages}IIBBBB")
+    if record.size != record_size:
+        raise SystemExit(f"record size {record_size} doesn't match {stages} stages")
+    header = {"capacity": capacity, "count": count, "now_us": now_us}
+
+    records = {}
+    for offset in range(HEADER.size, len(dump) - record_size + 1, record_size):
+        fields = record.unpack_from(dump, offset)
+        start, stage_us, (seq, route, key, event_type, flags) = fields[0], fields[1 : 1 + stages], fields[1 + stages :]
+        if seq == 0:
+            continue
+        # A record rewritten while the dump was sent shows up under its new seq
+        records[seq] = {
+            "seq": seq,
+            "start_us": start,
+            "stages": dict(zip(STAGES, (None if us == NOT_REACHED else us for us in stage_us))),
+            "route": route,
+            "key": key,
+            "type": event_type,
+            "flags": flags,
+        }
+    return header, [records[seq] for seq in sorted(records)]
+
+
+def intervals(record):
+    """Microseconds spent in each stage of one event; None where it was skipped."""
+    at = record["stages"]
+    result = dict.fromkeys(INTERVALS)
+
+    def between(a, b):
+        return at[b] - at[a] if at[a] is not None and at[b] is not None else None
+
+    result["receive"] = at["parsed"]
+    result["route"] = between("parsed", "routed")
+    result["decode"] = between("routed", "decoded")
+    result["handoff"] = between("decoded", "triggers-start")
+    result["triggers"] = between("triggers-start", "triggers-end")
+    if at["sent"] is not None:
+        # Without a network task the triggers run before the response is sent;
+        # with one the response doesn't wait for them
+        if record["flags"] & FLAG_QUEUED or at["triggers-end"] is None:
+            result["respond"] = between("decoded", "sent")
+        else:
+            result["respond"] = between("triggers-end", "sent")
+    ends = [us for us in (at["sent"], at["triggers-end"]) if us is not None]
+    result["total"] = max(ends) if ends else None
+    return result
+
+
+def percentile(samples, pct):
+    ordered = sorted(samples)
+    return ordered[min(len(ordered) - 1, int(round(pct / 100.0 * (len(ordered) - 1))))]
+
+
+def describe(record, names):
+    key = names.get(record["key"], str(record["key"]))
+    event_type = EVENT_TYPES[record["type"]] if record["type"] < len(EVENT_TYPES) else str(record["type"])
+    via = "ecp2" if record["flags"] & FLAG_ECP2 else ROUTE_NAMES.get(record["route"], str(record["route"]))
+    return f"{key} {event_type} via {via}{' queued' if record['flags'] & FLAG_QUEUED else ''}"
+
+
+def report(records):
+    per_stage = {name: [] for name in INTERVALS}
+    for record in records:
+        for name, us in intervals(record).items():
+            if us is not None:
+                per_stage[name].append(us)
+    total_mean = statistics.mean(per_stage["total"]) if per_stage["total"] else 0
+
+    print(f"{'stage':<10} {'n':>6} {'p50':>8} {'p90':>8} {'p99':>8} {'max':>8} {'mean':>8} {'share':>6}   (us)")
+    for name in INTERVALS:
+        samples = per_stage[name]
+        if not samples:
+            print(f"{name:<10} {0:>6}")
+            continue
+        mean = statistics.mean(samples)
+        share = f"{100.0 * mean / total_mean:5.1f}%" if total_mean and name != "total" else ""
+        print(
+            f"{name:<10} {len(samples):>6} {percentile(samples, 50):>8} {percentile(samples, 90):>8} "
+            f"{percentile(samples, 99):>8} {max(samples):>8} {mean:>8.0f} {share:>6}"
+        )
+    stages = [name for name in INTERVALS[:-1] if per_stage[name]]
+    if stages:
+        slowest = max(stages, key=lambda name: statistics.mean(per_stage[name]))
+        print(f"\nslowest stage on average: {slowest}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8060, help="ECP HTTP port")
+    parser.add_argument("--timeout", type=float, default=5.0)
+    parser.add_argument("--file", help="decode a saved dump instead of fetching one")
+    parser.add_argument("--save", help="also write the fetched dump to this file")
+    parser.add_argument("--key", help="only events for this key name (e.g. VolumeUp)")
+    parser.add_argument("--slowest", type=int, default=0, help="list the N slowest events stage by stage")
+    args = parser.parse_args()
+
+    if args.file:
+        with open(args.file, "rb") as saved:
+            dump = saved.read()
+    else:
+        dump = fetch(args.host, args.port, args.timeout)
+        if args.save:
+            with open(args.save, "wb") as out:
+                out.write(dump)
+
+    header, records = parse(dump)
+    if header["capacity"] == 0:
+        raise SystemExit("tracing is off on the device, set trace_size in its emulated_roku config")
+    names = key_names()
+    if args.key:
+        records = [r for r in records if names.get(r["key"]) == args.key]
+    print(f"{len(records)} key event(s), ring holds {header['capacity']}")
+    if not records:
+        return
+    report(records)
+
+    if args.slowest:
+        print(f"\n{'seq':>8} {'total':>8}  " + " ".join(f"{name:>8}" for name in INTERVALS[:-1]) + "  event")
+        ranked = sorted(records, key=lambda r: intervals(r)["total"] or 0, reverse=True)
+        for record in ranked[: args.slowest]:
+            spent = intervals(record)
+            cells = " ".join(f"{'-' if spent[name] is None else spent[name]:>8}" for name in INTERVALS[:-1])
+            print(f"{record['seq']:>8} {spent['total'] or 0:>8}  {cells}  {describe(record, names)}")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
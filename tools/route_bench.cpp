@@ -0,0 +1,122 @@
+// Route lookup benchmark: the route table in routes.h against the matcher it
+// replaced, a vector of exact-match routes with std::function handlers and a
+// not-found handler re-matching parameter paths with a chain of prefix
+// compares. Only the lookup is timed, handlers are never called.
+//
+// Builds against the host test stand-ins for ESPHome core:
+//
+//   g++ -std=gnu++17 -O2 -DUSE_HOST -Itests/host/stubs -I. -o route_bench tools/route_bench.cpp tests/host/stubs/stubs.cpp
+//   ./route_bench [lookups]
+#include "esphome/components/emulated_roku/routes.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace esphome::emulated_roku;
+
+// The matcher as it was: every route is compared in registration order, and
+// the not-found handler picks out the parameter paths
+class PrefixChainRouter {
+ public:
+  PrefixChainRouter() {
+    on("/", HttpMethod::GET, ECP_ROUTE_ROOT);
+    on("/keypress/", HttpMethod::POST, ECP_ROUTE_KEYPRESS);
+    on("/keydown/", HttpMethod::POST, ECP_ROUTE_KEYDOWN);
+    on("/keyup/", HttpMethod::POST, ECP_ROUTE_KEYUP);
+    on("/launch/", HttpMethod::POST, ECP_ROUTE_LAUNCH);
+    on("/query/apps", HttpMethod::GET, ECP_ROUTE_APPS);
+    on("/query/active-app", HttpMethod::GET, ECP_ROUTE_ACTIVE_APP);
+    on("/query/device-info", HttpMethod::GET, ECP_ROUTE_DEVICE_INFO);
+    on("/query/emulated-stats", HttpMethod::GET, ECP_ROUTE_STATS);
+    on("/query/icon/", HttpMethod::GET, ECP_ROUTE_ICON);
+    on("/input", HttpMethod::POST, ECP_ROUTE_INPUT);
+    on("/search", HttpMethod::POST, ECP_ROUTE_SEARCH);
+  }
+
+  uint8_t match(HttpMethod method, const char *uri) const {
+    for (const auto &route : routes_) {
+      if (route.method == method && strcmp(route.uri, uri) == 0)
+        return route.tag;
+    }
+    if (starts_with(uri, "/keypress/") || starts_with(uri, "/keydown/") || starts_with(uri, "/keyup/")) {
+      if (method == HttpMethod::POST) {
+        if (starts_with(uri, "/keypress/"))
+          return ECP_ROUTE_KEYPRESS;
+        if (starts_with(uri, "/keydown/"))
+          return ECP_ROUTE_KEYDOWN;
+        return ECP_ROUTE_KEYUP;
+      }
+    }
+    if (starts_with(uri, "/launch/") && method == HttpMethod::POST)
+      return ECP_ROUTE_LAUNCH;
+    if (starts_with(uri, "/query/icon/") && method == HttpMethod::GET)
+      return ECP_ROUTE_ICON;
+    return ECP_ROUTE_OTHER;
+  }
+
+ protected:
+  struct Route {
+    const char *uri;
+    HttpMethod method;
+    uint8_t tag;
+    std::function<void()> handler;
+  };
+
+  void on(const char *uri, HttpMethod method, uint8_t tag) { routes_.push_back(Route{uri, method, tag, [] {}}); }
+
+  static bool starts_with(const char *str, const char *prefix) { return strncmp(str, prefix, strlen(prefix)) == 0; }
+
+  std::vector<Route> routes_;
+};
+
+struct Request {
+  HttpMethod method;
+  const char *uri;
+};
+
+static const Request REQUESTS[] = {
+    {HttpMethod::POST, "/keypress/Home"},
+    {HttpMethod::POST, "/keyup/Lit_a"},
+    {HttpMethod::GET, "/query/device-info"},
+    {HttpMethod::GET, "/query/icon/12"},
+    {HttpMethod::POST, "/launch/837"},
+    {HttpMethod::GET, "/favicon.ico"},
+};
+
+template<typename Lookup> static double time_lookups(long count, Lookup lookup) {
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < count; i++)
+    lookup();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+int main(int argc, char **argv) {
+  long count = argc > 1 ? atol(argv[1]) : 2000000;
+  PrefixChainRouter old_router;
+  volatile unsigned sink = 0;
+
+  printf("%-20s %10s %10s\n", "path", "old ns", "table ns");
+  for (const auto &request : REQUESTS) {
+    char uri[64];
+    snprintf(uri, sizeof(uri), "%s", request.uri);
+    // Through a volatile pointer, so the compiler can't hoist the lookup out
+    char *volatile path = uri;
+    uint8_t old_route = old_router.match(request.method, path);
+    char *param;
+    uint8_t new_route = match_ecp_route(request.method, path, &param);
+    if (old_route != new_route) {
+      printf("%-20s routes differ: %u and %u\n", request.uri, old_route, new_route);
+      return 1;
+    }
+
+    double old_ns = time_lookups(count, [&] { sink = sink + old_router.match(request.method, path); });
+    double new_ns = time_lookups(count, [&] {
+      char *param;
+      sink = sink + match_ecp_route(request.method, path, &param);
+    });
+    printf("%-20s %10.1f %10.1f\n", request.uri, old_ns, new_ns);
+  }
+  return 0;
+}